@@ -1,11 +1,13 @@
 #include <client/Client.hpp>
 #include <common/protocol/utils.hpp>
 #include <common/protocol/HeartBeat.hpp>
+#include <common/protocol/MapSnapshot.hpp>
 #include <common/utils.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <cassert>
-#include <thread>
+#include <cstring>
 
 using namespace std::chrono_literals;
 
@@ -13,14 +15,25 @@ using namespace std::chrono_literals;
 static constexpr auto server_default_port = 12345;
 static constexpr auto gui_default_hostname = "localhost";
 static constexpr auto gui_default_port = 12346;
+static constexpr auto multicast_default_port = 12347;
 
 static constexpr auto heartbeat_interval = 20ms;
 static constexpr auto game_server_timeout = 1min;
 
 static constexpr auto events_ahead_treshold = 100;
+// Datagram starting within the treshold fits entirely, it carries
+// less than one event per byte (pixel runs).
+const std::size_t Client::events_window_size = events_ahead_treshold + max_datagram_size;
 // TODO timeout for "previous events" (received event_no=X, but not X-1)
 
 static constexpr auto socket_send_io_max_tries = 3;
+static constexpr std::size_t gui_output_limit = 256 * 1024;  // bytes queued for GUI
+
+// Poller tags
+static constexpr uint64_t gui_socket_tag = 0;
+static constexpr uint64_t gs_socket_tag = 1;
+static constexpr uint64_t heartbeat_timer_tag = 2;
+static constexpr uint64_t multicast_socket_tag = 3;
 
 
 static std::pair<std::string, unsigned short> with_default_port(std::string address, unsigned short port);
@@ -34,8 +47,46 @@ Client::Client(int argc, char *argv[]) noexcept {
 
 
 void Client::parse_arguments(int argc, char **argv) noexcept {
+    // Options go first. Names may start with '-' too, so options are looked for
+    // only if there are more arguments than player_name, game_server and ui_server
+    // (plain command lines keep their meaning), and each option only if
+    // player_name and game_server still follow it.
+    std::string multicast_group;
+    bool options = argc > 4;
+    while (options) {
+        if (argc >= 4 && strcmp(argv[1], "-e") == 0) {
+            extensions = true;
+            argc--;
+            argv++;
+        }
+        else if (argc >= 5 && strcmp(argv[1], "-f") == 0) {
+            try {
+                parity_group_size = to_number<uint32_t>("-f", argv[2], 1, max_parity_group_size);
+                extensions = true;  // parity group size is one of them
+            }
+            catch (std::exception &exc) {
+                exit_with_error(exc.what());
+            }
+            argc -= 2;
+            argv += 2;
+        }
+        else if (argc >= 5 && strcmp(argv[1], "-m") == 0) {
+            multicast_group = argv[2];
+            extensions = true;  // server must know the client is a group member
+            argc -= 2;
+            argv += 2;
+        }
+        else {
+            options = false;
+        }
+    }
+
     if (argc < 3 || 4 < argc) {
-        exit_with_error("Usage: ./siktacka-client player_name game_server_host[:port] [ui_server_host[:port]]");
+        exit_with_error("Usage: ./siktacka-client [-e] [-f parity_group_size] "
+                        "[-m multicast_group[:port]] player_name game_server_host[:port] "
+                        "[ui_server_host[:port]]\n"
+                        "Options are recognized only with more than 3 arguments, "
+                        "e.g. -e player_name host ui_host.");
     }
 
     player_name = argv[1];
@@ -60,6 +111,16 @@ void Client::parse_arguments(int argc, char **argv) noexcept {
         exit_with_error("Failed to resolve GUI address.");
     }
     std::cout << "Resolved GUI address as " << gui_address.to_string() << std::endl;
+
+    if (!multicast_group.empty()) {
+        address = with_default_port(multicast_group, multicast_default_port);
+        if (!multicast_address.resolve(address.first, address.second)
+                || !multicast_address.is_multicast()) {
+            exit_with_error("Failed to resolve multicast group address.");
+        }
+        std::cout << "Resolved multicast group address as " << multicast_address.to_string()
+                  << std::endl;
+    }
 }
 
 
@@ -84,7 +145,7 @@ void Client::run() {
         receive_events_from_server();  // at last, we want to receive new events
 
         if (!pending_work()) {
-            std::this_thread::sleep_for(1ms);  // sleep a little bit if no more work
+            wait_for_work();  // new work comes only from sockets or heartbeat timer
         }
     }
 }
@@ -106,6 +167,29 @@ void Client::init_client() {
         exit_with_error("Failed to make sockets non blocking.");
     }
 
+    if (multicast_address.get() != nullptr) {
+        // bound to the group's address, so nothing else is received
+        if (multicast_socket.init(multicast_address.get()->ip_version) != Socket::Status::Done
+                || multicast_socket.set_reuse_address() != Socket::Status::Done
+                || multicast_socket.bind(multicast_address) != Socket::Status::Done
+                || multicast_socket.join_group(multicast_address) != Socket::Status::Done
+                || multicast_socket.set_blocking(false) != Socket::Status::Done) {
+            exit_with_error("Failed to join multicast group.");
+        }
+        std::cout << "Joined multicast group." << std::endl;
+    }
+
+    if (!poller.init(4) || !heartbeat_timer.init()
+            || !poller.add(gui_socket.get_fd(), gui_interest, gui_socket_tag)
+            || !poller.add(gs_socket.get_fd(), Poller::readable, gs_socket_tag)
+            || !poller.add(heartbeat_timer.get_fd(), Poller::readable, heartbeat_timer_tag)) {
+        exit_with_error("Failed to initialize epoll event loop.");
+    }
+    if (multicast_address.get() != nullptr
+            && !poller.add(multicast_socket.get_fd(), Poller::readable, multicast_socket_tag)) {
+        exit_with_error("Failed to initialize epoll event loop.");
+    }
+
     using namespace std::chrono;
     client_state.last_server_response = system_clock::now();
     client_state.session_id = duration_cast<microseconds>(
@@ -113,28 +197,60 @@ void Client::init_client() {
 }
 
 
+void Client::wait_for_work() {
+    // Queued output waits for GUI socket to become writable. Queue is flushed
+    // by send_updates_to_gui() in the next iteration.
+    auto interest = Poller::readable | (gui_socket.get_queued_size() > 0 ? Poller::writable : 0);
+    if (interest != gui_interest) {
+        if (!poller.modify(gui_socket.get_fd(), interest, gui_socket_tag)) {
+            exit_with_error("Failed to update epoll interest.");
+        }
+        gui_interest = interest;
+    }
+
+    if (!heartbeat_timer.arm(client_state.next_hb_time)) {
+        exit_with_error("Failed to arm heartbeat timer.");
+    }
+
+    auto ready_cnt = poller.wait(-1);
+    if (ready_cnt < 0) {
+        exit_with_error("Failed to wait for events.");
+    }
+
+    for (auto i = 0; i < ready_cnt; i++) {
+        if (poller.ready_tag(i) == heartbeat_timer_tag) {
+            heartbeat_timer.consume();
+        }
+    }
+}
+
+
 void Client::handle_gui_input() {
-    std::string buffer;
+    const char *line;
+    std::size_t size;
+    auto line_is = [&line, &size](const char *command) {
+        return size == strlen(command) && memcmp(line, command, size) == 0;
+    };
 
     while (!is_heartbeat_pending()) {
-        auto data_received = handle_socket_io([&buffer, this]() {
-            return gui_socket.receive_line(buffer);
+        auto data_received = handle_socket_io([&line, &size, this]() {
+            return gui_socket.receive_line(line, size);
         }, "GUI", "receiving");
 
         if (!data_received) {
             return;
         }
 
-        if (buffer == "LEFT_KEY_DOWN") {
+        if (line_is("LEFT_KEY_DOWN")) {
             gui_state.left_key_down = true;
         }
-        else if (buffer == "LEFT_KEY_UP") {
+        else if (line_is("LEFT_KEY_UP")) {
             gui_state.left_key_down = false;
         }
-        else if (buffer == "RIGHT_KEY_DOWN") {
+        else if (line_is("RIGHT_KEY_DOWN")) {
             gui_state.right_key_down = true;
         }
-        else if (buffer == "RIGHT_KEY_UP") {
+        else if (line_is("RIGHT_KEY_UP")) {
             gui_state.right_key_down = false;
         }
         else {
@@ -156,9 +272,29 @@ void Client::send_heartbeat() {
     HeartBeat hb = {
             client_state.session_id,
             turn_direction,
-            game_state.next_event_no,
+            std::max(game_state.next_event_no, snapshot_state.applied_cnt),
             player_name,
     };
+    if (extensions) {
+        hb.parity_group_size = parity_group_size;
+        hb.capabilities = HeartBeat::Capability::Snapshots
+                          | HeartBeat::Capability::CompressedDatagrams
+                          | HeartBeat::Capability::PixelRuns;
+        if (multicast_address.get() != nullptr) {
+            hb.capabilities |= HeartBeat::Capability::MulticastEvents;
+        }
+
+        if (hb.next_expected_event_no == 0) {
+            hb.next_expected_fragment_no = snapshot_state.next_fragment_no;
+        }
+        else {
+            // events received after a lost datagram, server does not send them again
+            for (std::size_t i = 0; i < hb.received_events.size(); i++) {
+                hb.received_events[i] =
+                        game_state.events.get(hb.next_expected_event_no + 1 + i) != nullptr;
+            }
+        }
+    }
 
     if (!hb.validate()) {
         exit_with_error("Constructed invalid HeartBeat packet.");
@@ -176,30 +312,48 @@ void Client::send_heartbeat() {
 
 
 void Client::send_updates_to_gui() {
-    while (!is_heartbeat_pending()) {
-        if (gui_state.next_event_no == game_state.next_event_no) {
-            return;
-        }
-
-        // move event out of collection; after sending it, we don't need it anymore
-        auto event_ptr = std::move(game_state.events[gui_state.next_event_no]);
+    // Events are queued as lines and sent in batches. Slow GUI makes the queue
+    // grow up to the limit, then events wait in the window (and further ones
+    // are received again later), so the client does not give up on it.
+    while (!is_heartbeat_pending()
+           && gui_state.next_event_no < game_state.next_event_no
+           && gui_socket.get_queued_size() < gui_output_limit) {
+        // slot is freed right away, event is forwarded from a copy
+        assert(game_state.events.get(gui_state.next_event_no) != nullptr);
+        auto compact = *game_state.events.get(gui_state.next_event_no);
+        game_state.events.pop_front();
         gui_state.next_event_no++;
-        assert(event_ptr != nullptr);
-        if (event_ptr->type == GameEvent::Type::GameOver) {
+        auto type = static_cast<GameEvent::Type>(compact.type);
+        if (type == GameEvent::Type::GameOver) {
             continue;
         }
 
-        assert(event_ptr->validate(GameEvent::Format::Text));
-        auto data = event_ptr->serialize(GameEvent::Format::Text);
+        // processed events refer to valid players
+        auto &lines = gui_state.lines;
+        switch (type) {
+            case GameEvent::Type::NewGame:
+                gui_socket.queue_line(lines.new_game(compact.x, compact.y));
+                break;
 
-        auto data_sent = handle_socket_io([&data, this]() {
-            return this->gui_socket.send_line(data);
-        }, "GUI", "sending", socket_send_io_max_tries);
+            case GameEvent::Type::Pixel:
+                gui_socket.queue_line(lines.pixel(compact.x, compact.y, compact.player_no));
+                break;
 
-        if (!data_sent) {
-            exit_with_error("Failed to sent data to GUI (tried some times).");
+            case GameEvent::Type::PlayerEliminated:
+                gui_socket.queue_line(lines.player_eliminated(compact.player_no));
+                break;
+
+            default:
+                assert(false);
+                break;
         }
     }
+
+    if (gui_socket.get_queued_size() > 0) {
+        handle_socket_io([this]() {
+            return this->gui_socket.flush();
+        }, "GUI", "sending");
+    }
 }
 
 
@@ -208,18 +362,22 @@ bool Client::pending_work() const {
         return true;
     }
 
-    // pending updates to be sent to GUI
-    if (gui_state.next_event_no < game_state.next_event_no) {
+    // pending updates to be sent to GUI, unless they wait for it to read the queue
+    if (gui_state.next_event_no < game_state.next_event_no
+            && gui_socket.get_queued_size() < gui_output_limit) {
         return true;
     }
 
     // pending events to be processed
-    if (game_state.next_event_no < game_state.events.size()
-            && game_state.events[game_state.next_event_no] != nullptr) {
+    if (game_state.events.get(game_state.next_event_no) != nullptr) {
         return true;
     }
 
-    // TODO check if data awaiting on sockets (should not make real difference)
+    // snapshot to be put into the window
+    if (snapshot_state.expanded_cnt < snapshot_state.applied_cnt
+            && snapshot_state.expanded_cnt < game_state.events.get_end_no()) {
+        return true;
+    }
 
     return false;
 }
@@ -227,6 +385,7 @@ bool Client::pending_work() const {
 
 void Client::receive_events_from_server() {
     std::string buffer;
+    std::string recovered;
     HostAddress src_addr;
 
     while (!is_heartbeat_pending()) {
@@ -236,6 +395,15 @@ void Client::receive_events_from_server() {
             return this->gs_socket.receive(buffer, src_addr);
         }, "Game server", "receiving");
 
+        // group's datagrams come from server's port for the group, which
+        // differs from gs_address's one, so only the host is checked
+        bool from_group = false;
+        if (!data_received && multicast_address.get() != nullptr) {
+            data_received = from_group = handle_socket_io([&buffer, &src_addr, this]() {
+                return this->multicast_socket.receive(buffer, src_addr);
+            }, "Multicast group", "receiving");
+        }
+
         if (!data_received) {
             if (client_state.last_server_response + game_server_timeout < now) {
                 exit_with_error("Game server time out.");
@@ -243,7 +411,7 @@ void Client::receive_events_from_server() {
             break;
         }
 
-        if (src_addr != gs_address) {
+        if (from_group ? !src_addr.is_same_host(gs_address) : src_addr != gs_address) {
             std::cout << "Info: received data from not-server." << std::endl;
             continue;
         }
@@ -253,27 +421,37 @@ void Client::receive_events_from_server() {
             continue;
         }
 
-        MultipleGameEvent new_events;
-        if (!new_events.deserialize(buffer)) {
+        if (is_parity_datagram(buffer.data(), buffer.size())) {
+            // rebuilt datagram is handled as if it was received
+            if (parity_group_size == 0 || !parity.recover(buffer.data(), buffer.size(), recovered)) {
+                continue;
+            }
+            buffer.swap(recovered);
+        }
+        else if (parity_group_size > 0 && !from_group) {
+            parity.remember(buffer.data(), buffer.size());
+        }
+
+        if (!received_events.parse(buffer.data(), buffer.size())) {
             std::cout << "Info: Received malformed data from server." << std::endl;
             continue;
         }
 
         client_state.last_server_response = now;
-        handle_newly_received_events(new_events);
+        handle_newly_received_events(received_events);
     }
 }
 
 
-void Client::handle_newly_received_events(MultipleGameEvent &new_events) {
+void Client::handle_newly_received_events(const MultipleGameEventView &new_events) {
     if (client_state.prev_game_ids.count(new_events.game_id) > 0) {
         return;
     }
 
     // Check events number
-    auto first_no = new_events.events[0]->event_no;
+    auto first_no = new_events.events[0].event_no;
     for (std::size_t i = 1; i < new_events.events.size(); i++) {
-        if (new_events.events[i]->event_no != first_no + i) {
+        if (new_events.events[i].event_no != first_no + i) {
             exit_with_error(
                     "Error: received out of order events in one datagram from server.");
         }
@@ -283,6 +461,13 @@ void Client::handle_newly_received_events(MultipleGameEvent &new_events) {
         init_new_game(new_events.game_id);
     }
 
+    if (new_events.events[0].type == GameEvent::Type::Snapshot) {
+        for (const auto &event : new_events.events) {
+            handle_snapshot_fragment(event);
+        }
+        return;
+    }
+
     enqueue_events(new_events);
 }
 
@@ -294,53 +479,193 @@ void Client::init_new_game(uint32_t new_game_id) {
     game_state.maxx = game_state.maxy = 0;
     game_state.players_names.clear();
     game_state.events.clear();
+    game_state.new_game_names.clear();
     game_state.game_over = false;
     game_state.next_event_no = gui_state.next_event_no = 0;
+
+    snapshot_state.events_cnt = snapshot_state.next_fragment_no = 0;
+    snapshot_state.fragments.clear();
+    snapshot_state.applied = MapSnapshot();
+    snapshot_state.applied_cnt = snapshot_state.expanded_cnt = 0;
 }
 
 
-void Client::enqueue_events(MultipleGameEvent &events) {
-    auto &first_ev_ptr = events.events.front();
-    auto &last_ev_ptr = events.events.back();
+void Client::enqueue_events(const MultipleGameEventView &events) {
+    auto first_no = events.events.front().event_no;
+    auto last_no = events.events.back().event_no;
 
-    if (last_ev_ptr->event_no < game_state.next_event_no
-        || game_state.next_event_no + events_ahead_treshold < first_ev_ptr->event_no) {
+    if (last_no < game_state.next_event_no
+        || game_state.next_event_no + events_ahead_treshold < first_no) {
         return;
     }
 
-    if (game_state.events.size() <= last_ev_ptr->event_no) {
-        game_state.events.resize(last_ev_ptr->event_no + 1);
+    for (const auto &event : events.events) {
+        if (event.event_no < snapshot_state.applied_cnt) {
+            continue;  // these are taken from snapshot
+        }
+
+        bool put = false;
+        switch (event.type) {
+            case GameEvent::Type::NewGame:
+                put = game_state.events.put(event.event_no, event.type, 0,
+                                            event.new_game.maxx, event.new_game.maxy);
+                if (put) {
+                    // the only data outliving the datagram
+                    game_state.new_game_names.assign(event.new_game.names,
+                                                     event.new_game.names_size);
+                }
+                break;
+
+            case GameEvent::Type::Pixel:
+                put = game_state.events.put(event.event_no, event.type, event.pixel.player_no,
+                                            event.pixel.x, event.pixel.y);
+                break;
+
+            case GameEvent::Type::PlayerEliminated:
+                put = game_state.events.put(event.event_no, event.type,
+                                            event.player_eliminated.player_no);
+                break;
+
+            default:  // the rest is rejected while processing
+                put = game_state.events.put(event.event_no, event.type);
+                break;
+        }
+
+        if (!put && game_state.events.get_end_no() <= event.event_no) {
+            break;  // no space for the following ones either
+        }
     }
+}
 
-    for (auto &ev_ptr : events.events) {
-        if (game_state.events[ev_ptr->event_no] != nullptr) {
-            continue;
+
+void Client::handle_snapshot_fragment(const GameEventView &event) {
+    if (event.type != GameEvent::Type::Snapshot || game_state.next_event_no > 0
+            || snapshot_state.applied_cnt > 0) {
+        return;  // we are already following the game
+    }
+
+    auto &data = event.snapshot;
+    auto &fragments = snapshot_state.fragments;
+    if (event.event_no != snapshot_state.events_cnt || data.fragments_cnt != fragments.size()) {
+        // server rebuilt the snapshot, we have to start over
+        snapshot_state.events_cnt = event.event_no;
+        snapshot_state.next_fragment_no = 0;
+        fragments.assign(data.fragments_cnt, std::string());
+    }
+
+    if (fragments[data.fragment_no].empty()) {
+        fragments[data.fragment_no].assign(data.fragment, data.fragment_size);
+    }
+    while (snapshot_state.next_fragment_no < fragments.size()
+           && !fragments[snapshot_state.next_fragment_no].empty()) {
+        snapshot_state.next_fragment_no++;
+    }
+
+    if (snapshot_state.next_fragment_no == fragments.size()) {
+        apply_snapshot();
+    }
+}
+
+
+void Client::apply_snapshot() {
+    std::string compressed;
+    for (auto &fragment : snapshot_state.fragments) {
+        compressed.append(fragment);
+    }
+    auto events_cnt = snapshot_state.events_cnt;
+    snapshot_state.events_cnt = snapshot_state.next_fragment_no = 0;
+    snapshot_state.fragments.clear();
+
+    auto &snapshot = snapshot_state.applied;
+    if (!snapshot.decompress(compressed) || snapshot.events_cnt() != events_cnt) {
+        std::cout << "Info: Received malformed snapshot from server." << std::endl;
+        return;
+    }
+
+    GameEvent new_game;
+    new_game.type = GameEvent::Type::NewGame;
+    new_game.new_game_data.maxx = snapshot.maxx;
+    new_game.new_game_data.maxy = snapshot.maxy;
+    new_game.new_game_data.players_names = std::move(snapshot.players_names);
+    if (!new_game.validate(GameEvent::Format::Binary)) {
+        exit_with_error("Server error: got snapshot with invalid NewGame data.");
+    }
+
+    auto &names = game_state.new_game_names;
+    names.clear();
+    for (const auto &name : new_game.new_game_data.players_names) {
+        names.append(name);
+        names.push_back('\0');
+    }
+
+    // Events in a different order, but leading to the same state. Pixels and
+    // eliminations are processed and validated as if they were received.
+    // They replace all received ones, the window is filled as it moves.
+    game_state.events.clear();
+    snapshot_state.applied_cnt = events_cnt;
+    snapshot_state.expanded_cnt = 0;
+    expand_snapshot();
+
+    std::cout << "Caught up with game using snapshot of " << events_cnt << " events."
+              << std::endl;
+}
+
+
+void Client::expand_snapshot() {
+    auto &snapshot = snapshot_state.applied;
+    auto &event_no = snapshot_state.expanded_cnt;
+    const auto pixels_cnt = snapshot.pixels.size();
+    auto end_no = std::min(snapshot_state.applied_cnt, game_state.events.get_end_no());
+
+    for (; event_no < end_no; event_no++) {
+        if (event_no == 0) {
+            game_state.events.put(event_no, GameEvent::Type::NewGame, 0,
+                                  snapshot.maxx, snapshot.maxy);
         }
+        else if (event_no <= pixels_cnt) {
+            const auto &pixel = snapshot.pixels[event_no - 1];
+            game_state.events.put(event_no, GameEvent::Type::Pixel, pixel.player_no,
+                                  pixel.x, pixel.y);
+        }
+        else {
+            game_state.events.put(event_no, GameEvent::Type::PlayerEliminated,
+                                  snapshot.eliminated[event_no - 1 - pixels_cnt]);
+        }
+    }
 
-        game_state.events[ev_ptr->event_no] = std::move(ev_ptr);
+    if (event_no == snapshot_state.applied_cnt) {
+        snapshot = MapSnapshot();  // releasing memory
     }
 }
 
 
 void Client::process_events() {
+    if (snapshot_state.expanded_cnt < snapshot_state.applied_cnt) {
+        expand_snapshot();
+    }
+
+    const EventWindow::Event *event;
     while (!is_heartbeat_pending()
-           && game_state.next_event_no < game_state.events.size()
-           && game_state.events[game_state.next_event_no] != nullptr) {
-        auto &event = game_state.events[game_state.next_event_no];
-        game_state.next_event_no++;
+           && (event = game_state.events.get(game_state.next_event_no)) != nullptr) {
+        auto event_no = game_state.next_event_no++;
 
-        auto error_msg = validate_game_event(*event);
+        auto error_msg = validate_game_event(event_no, *event);
         if (!error_msg.empty()) {
             exit_with_error(std::move(error_msg));
         }
 
         // process new game event
-        switch (event->type) {
+        switch (static_cast<GameEvent::Type>(event->type)) {
             case GameEvent::Type::NewGame: {
-                auto &data = event->new_game_data;
-                game_state.maxx = data.maxx;
-                game_state.maxy = data.maxy;
-                game_state.players_names = data.players_names;
+                game_state.maxx = event->x;
+                game_state.maxy = event->y;
+                game_state.players_names.clear();
+                const auto &names = game_state.new_game_names;
+                for (std::size_t it = 0; it < names.size(); ) {
+                    game_state.players_names.emplace_back(&names[it]);
+                    it += game_state.players_names.back().size() + 1;
+                }
+                gui_state.lines.set_players_names(game_state.players_names);
                 game_state.game_over = false;
 
                 std::cout << "New game started. Players: ";
@@ -351,16 +676,9 @@ void Client::process_events() {
                 break;
             }
 
-            case GameEvent::Type::Pixel: {
-                auto &data = event->pixel_data;
-                data.player_name = game_state.players_names[data.player_no];
-                break;
-            }
-
             case GameEvent::Type::PlayerEliminated: {
-                auto &data = event->player_eliminated_data;
-                data.player_name = game_state.players_names[data.player_no];
-                std::cout << "Player eliminated: " << data.player_name << "." << std::endl;
+                std::cout << "Player eliminated: " << game_state.players_names[event->player_no]
+                          << "." << std::endl;
                 break;
             }
 
@@ -377,12 +695,13 @@ void Client::process_events() {
 }
 
 
-std::string Client::validate_game_event(const GameEvent &event) {
-    if (event.event_no == 0 && event.type != GameEvent::Type::NewGame) {
+std::string Client::validate_game_event(uint32_t event_no, const EventWindow::Event &event) {
+    auto type = static_cast<GameEvent::Type>(event.type);
+    if (event_no == 0 && type != GameEvent::Type::NewGame) {
         return "Server error: first game event is not NewGame.";
     }
 
-    if (event.event_no > 0 && event.type == GameEvent::Type::NewGame) {
+    if (event_no > 0 && type == GameEvent::Type::NewGame) {
         return "Server error: got NewGame event with id != 0.";
     }
 
@@ -390,27 +709,36 @@ std::string Client::validate_game_event(const GameEvent &event) {
         return "Server error: got event after game over.";
     }
 
-    switch (event.type) {
+    switch (type) {
         case GameEvent::Type::NewGame:
             break;
 
         case GameEvent::Type::Pixel:
-            if (event.pixel_data.player_no >= game_state.players_names.size()) {
+            if (event.player_no >= game_state.players_names.size()) {
                 return "Server error: got player_no higher than number of players.";
             }
-            if (event.pixel_data.x >= game_state.maxx || event.pixel_data.y >= game_state.maxy) {
+            if (event.x >= game_state.maxx || event.y >= game_state.maxy) {
                 return "Server error: got pixel outside the map.";
             }
             break;
 
         case GameEvent::Type::PlayerEliminated:
-            if (event.player_eliminated_data.player_no >= game_state.players_names.size()) {
+            if (event.player_no >= game_state.players_names.size()) {
                 return "Server error: got player_no higher than number of players.";
             }
             break;
 
         case GameEvent::Type::GameOver:
             break;
+
+        case GameEvent::Type::Snapshot:
+            return "Server error: got snapshot fragment among events.";
+
+        case GameEvent::Type::PixelRun:  // expanded by MultipleGameEventView
+            return "Server error: got unexpanded pixel run.";
+
+        default:
+            return "Server error: got event of unknown type.";
     }
 
     return "";
@@ -424,13 +752,15 @@ std::pair<std::string, unsigned short> with_default_port(std::string address, un
         return std::make_pair(address, port);
     }
 
-    if (address.find(':') < divider_pos) {
+    auto host = address.substr(0, divider_pos);
+    if (address.front() == '[' && address.find(']') == divider_pos - 1) {
+        host = address.substr(1, divider_pos - 2);  // IPv6 with port, e.g. [ff05::1]:12347
+    }
+    else if (address.find(':') < divider_pos) {
         // Assuming IPv6
         return std::make_pair(address, port);
     }
 
-    auto host = address.substr(0, divider_pos);
-
     // If custom port:
     if (divider_pos < address.length() - 1) {
         try {
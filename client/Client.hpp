@@ -1,12 +1,18 @@
 #pragma once
 
+#include <client/EventWindow.hpp>
+#include <client/GuiLineEncoder.hpp>
 #include <common/network/HostAddress.hpp>
+#include <common/network/Poller.hpp>
 #include <common/network/TcpSocket.hpp>
+#include <common/network/Timer.hpp>
 #include <common/network/UdpSocket.hpp>
-#include <common/protocol/MultipleGameEvent.hpp>
+#include <common/protocol/DatagramParity.hpp>
+#include <common/protocol/GameEvent.hpp>
+#include <common/protocol/MapSnapshot.hpp>
+#include <common/protocol/MultipleGameEventView.hpp>
 
 #include <chrono>
-#include <deque>
 #include <memory>
 #include <unordered_set>
 
@@ -17,20 +23,48 @@ private:
     // command line arguments
     HostAddress gs_address;
     HostAddress gui_address;
+    HostAddress multicast_address;  // of group with live events, unset if not joined
     std::string player_name;
+    // Heartbeats carry extensions (capabilities etc.) only with -e or options
+    // using them, servers of the original protocol reject them as invalid
+    // player names.
+    bool extensions = false;
+    uint32_t parity_group_size = 0;  // 0 if parity datagrams are not wanted
 
     // sockets
     UdpSocket gs_socket;
     TcpSocket gui_socket;
+    UdpSocket multicast_socket;  // only if multicast_address is set
+
+    // event loop, see run()
+    Poller poller;
+    Timer heartbeat_timer;  // fires at client_state.next_hb_time
+    uint32_t gui_interest = Poller::readable;
 
     // game state
+    static const std::size_t events_window_size;
     struct {
         uint32_t maxx = 0, maxy = 0;
         std::vector<std::string> players_names;
-        MultipleGameEvent::Container events;
+        EventWindow events{events_window_size};  // starts with gui_state.next_event_no
+        std::string new_game_names;  // of NewGame event, null terminated
         uint32_t next_event_no = 0;
         bool game_over = false;
     } game_state;
+    MultipleGameEventView received_events;  // reused for every datagram
+    ParityDecoder parity;  // rebuilds lost datagrams, if parity_group_size is set
+
+    // snapshot being collected, see GameEvent::Type::Snapshot
+    struct {
+        uint32_t events_cnt = 0;  // described by snapshot, event_no of its fragments
+        std::vector<std::string> fragments;  // empty if not received yet
+        uint32_t next_fragment_no = 0;       // first one not received
+
+        // complete snapshot, its events are put into the window as it moves
+        MapSnapshot applied;
+        uint32_t applied_cnt = 0;   // events [0, applied_cnt) come from snapshot
+        uint32_t expanded_cnt = 0;  // of them already put into the window
+    } snapshot_state;
 
     // client state
     struct {
@@ -48,6 +82,7 @@ private:
         bool left_key_down = false;
         bool right_key_down = false;
         uint32_t next_event_no = 0;
+        GuiLineEncoder lines;  // names of the current game's players
     } gui_state;
 
 public:
@@ -57,16 +92,23 @@ public:
 private:
     void parse_arguments(int argc, char *argv[]) noexcept;
     void init_client();
+    // Blocks until a socket is ready or heartbeat is due.
+    void wait_for_work();
     void handle_gui_input();
     bool is_heartbeat_pending() const;
     void send_heartbeat();
     void send_updates_to_gui();
     bool pending_work() const;
     void receive_events_from_server();
-    void handle_newly_received_events(MultipleGameEvent &new_events);
+    void handle_newly_received_events(const MultipleGameEventView &new_events);
     void init_new_game(uint32_t new_game_id);
-    void enqueue_events(MultipleGameEvent &events);
+    void enqueue_events(const MultipleGameEventView &events);
+    void handle_snapshot_fragment(const GameEventView &event);
+    // Replaces events described by complete snapshot with equivalent ones.
+    void apply_snapshot();
+    // Puts next events of applied snapshot into the window, as many as fit.
+    void expand_snapshot();
     void process_events();
     // Returns empty string on success, otherwise error message.
-    std::string validate_game_event(const GameEvent &event);
+    std::string validate_game_event(uint32_t event_no, const EventWindow::Event &event);
 };
@@ -0,0 +1,65 @@
+#include <client/EventWindow.hpp>
+
+#include <cassert>
+
+
+static_assert(sizeof(EventWindow::Event) == 12, "Event is meant to be compact");
+constexpr uint8_t EventWindow::none;
+
+
+EventWindow::EventWindow(std::size_t capacity) {
+    std::size_t size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    events.resize(size);
+    clear();
+}
+
+
+void EventWindow::clear() noexcept {
+    for (auto &event : events) {
+        event.type = none;
+    }
+    first_no = 0;
+}
+
+
+uint32_t EventWindow::get_end_no() const noexcept {
+    return first_no + events.size();
+}
+
+
+bool EventWindow::put(uint32_t event_no, GameEvent::Type type, uint8_t player_no,
+                      uint32_t x, uint32_t y) noexcept {
+    if (event_no < first_no || get_end_no() <= event_no) {
+        return false;
+    }
+
+    auto &event = events[event_no & (events.size() - 1)];
+    if (event.type != none) {
+        return false;
+    }
+
+    event = {static_cast<uint8_t>(type), player_no, x, y};
+    return true;
+}
+
+
+const EventWindow::Event *EventWindow::get(uint32_t event_no) const noexcept {
+    if (event_no < first_no || get_end_no() <= event_no) {
+        return nullptr;
+    }
+
+    auto &event = events[event_no & (events.size() - 1)];
+    return event.type != none ? &event : nullptr;
+}
+
+
+void EventWindow::pop_front() noexcept {
+    auto &event = events[first_no & (events.size() - 1)];
+    assert(event.type != none);
+    event.type = none;
+    first_no++;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <common/protocol/GameEvent.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+// Received events of the current game, starting with the first one not yet
+// forwarded to GUI. Events are kept in a ring buffer of fixed capacity and
+// slots are freed as soon as their events are forwarded, so memory stays
+// the same however long the game is. Events beyond the window are not stored;
+// the server sends them again.
+class EventWindow final {
+public:
+    // Compact event, its event_no is implied by the position in the window.
+    struct Event {
+        uint8_t type;       // GameEvent::Type, none if slot is free
+        uint8_t player_no;  // Pixel, PlayerEliminated
+        uint32_t x, y;      // Pixel; maxx, maxy of NewGame (names are kept by the client)
+    };
+    static constexpr uint8_t none = UINT8_MAX;
+
+private:
+    std::vector<Event> events;  // capacity is a power of two
+    uint32_t first_no = 0;      // event_no of the window's first slot
+
+public:
+    // Window of at least given number of events.
+    explicit EventWindow(std::size_t capacity);
+
+    // Frees all slots, window starts with event 0 again.
+    void clear() noexcept;
+
+    // Number of the first event which does not fit into the window.
+    uint32_t get_end_no() const noexcept;
+
+    // Returns false if event does not fit into the window or it is already there.
+    bool put(uint32_t event_no, GameEvent::Type type, uint8_t player_no = 0,
+             uint32_t x = 0, uint32_t y = 0) noexcept;
+
+    // Returns nullptr if event is outside of the window or not received yet.
+    const Event *get(uint32_t event_no) const noexcept;
+
+    // Frees the first slot, window moves by one event.
+    void pop_front() noexcept;
+};
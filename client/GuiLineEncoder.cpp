@@ -0,0 +1,65 @@
+#include <client/GuiLineEncoder.hpp>
+
+#include <cassert>
+
+
+static constexpr std::size_t max_number_length = 10;  // of uint32_t
+
+
+void GuiLineEncoder::set_players_names(const std::vector<std::string> &players_names) {
+    names_suffix.clear();
+    name_suffixes.resize(players_names.size());
+    eliminated_lines.resize(players_names.size());
+
+    for (std::size_t i = 0; i < players_names.size(); i++) {
+        const auto &name = players_names[i];
+        names_suffix.push_back(' ');
+        names_suffix.append(name);
+
+        name_suffixes[i].assign(1, ' ');
+        name_suffixes[i].append(name);
+
+        eliminated_lines[i].assign("PLAYER_ELIMINATED ");
+        eliminated_lines[i].append(name);
+    }
+}
+
+
+const std::string &GuiLineEncoder::new_game(uint32_t maxx, uint32_t maxy) {
+    line.assign("NEW_GAME ");
+    append_number(maxx);
+    line.push_back(' ');
+    append_number(maxy);
+    line.append(names_suffix);
+    return line;
+}
+
+
+const std::string &GuiLineEncoder::pixel(uint32_t x, uint32_t y, uint8_t player_no) {
+    assert(player_no < name_suffixes.size());
+
+    line.assign("PIXEL ");
+    append_number(x);
+    line.push_back(' ');
+    append_number(y);
+    line.append(name_suffixes[player_no]);
+    return line;
+}
+
+
+const std::string &GuiLineEncoder::player_eliminated(uint8_t player_no) const noexcept {
+    assert(player_no < eliminated_lines.size());
+    return eliminated_lines[player_no];
+}
+
+
+void GuiLineEncoder::append_number(uint32_t value) {
+    char digits[max_number_length];
+    auto begin = digits + max_number_length;
+    do {
+        *--begin = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    line.append(begin, digits + max_number_length);
+}
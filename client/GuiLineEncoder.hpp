@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Formats events as lines of GUI protocol, the same as GameEvent::serialize
+// with Format::Text. Numbers are written without streams and locale, names
+// are rendered once per game and referred to by player_no, the line buffer
+// is reused, so in steady state formatting does not allocate.
+class GuiLineEncoder final {
+private:
+    std::string line;                      // the last formatted line
+    std::string names_suffix;              // " name1 name2 ..." of NEW_GAME
+    std::vector<std::string> name_suffixes;  // " name", indexed by player_no
+    std::vector<std::string> eliminated_lines;  // "PLAYER_ELIMINATED name"
+
+public:
+    // Renders names of players of a new game.
+    void set_players_names(const std::vector<std::string> &players_names);
+
+    // Return line without new line character, valid until the next call.
+    // player_no has to be smaller than the number of players.
+    const std::string &new_game(uint32_t maxx, uint32_t maxy);
+    const std::string &pixel(uint32_t x, uint32_t y, uint8_t player_no);
+    const std::string &player_eliminated(uint8_t player_no) const noexcept;
+
+private:
+    void append_number(uint32_t value);
+};
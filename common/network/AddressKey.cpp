@@ -0,0 +1,62 @@
+#include <common/network/AddressKey.hpp>
+
+#include <cstring>
+#include <type_traits>
+
+
+AddressKey::AddressKey() noexcept : words{} {
+}
+
+
+AddressKey::AddressKey(const HostAddress::SocketAddress &sock_addr) noexcept : words{} {
+    uint8_t ip[16] = {};
+    uint64_t port = 0;
+    uint64_t scope_id = 0;
+
+    switch (sock_addr.ip_version) {
+        case HostAddress::IpVersion::IPv4:
+            ip[10] = ip[11] = 0xff;
+            memcpy(ip + 12, &sock_addr.addr_v4.sin_addr, 4);
+            port = sock_addr.addr_v4.sin_port;
+            break;
+
+        case HostAddress::IpVersion::IPv6:
+            memcpy(ip, &sock_addr.addr_v6.sin6_addr, 16);
+            port = sock_addr.addr_v6.sin6_port;
+            scope_id = sock_addr.addr_v6.sin6_scope_id;
+            break;
+
+        case HostAddress::IpVersion::None:
+        default:
+            break;
+    }
+
+    using UndType = std::underlying_type<HostAddress::IpVersion>::type;
+    uint64_t ip_version = static_cast<UndType>(sock_addr.ip_version);
+
+    memcpy(&words[0], ip, 16);
+    words[2] = port | scope_id << 16 | ip_version << 48;
+}
+
+
+uint64_t AddressKey::hash() const noexcept {
+    // multiply-xorshift mixing, the lowest bits are used by hash tables
+    uint64_t h = words[0] * 0x9e3779b97f4a7c15ull;
+    h ^= (h >> 29) ^ words[1] * 0xbf58476d1ce4e5b9ull;
+    h ^= (h >> 31) ^ words[2] * 0x94d049bb133111ebull;
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ull;
+    h ^= h >> 32;
+    return h;
+}
+
+
+bool AddressKey::operator==(const AddressKey &rhs) const noexcept {
+    return words[0] == rhs.words[0] && words[1] == rhs.words[1] &&
+           words[2] == rhs.words[2];
+}
+
+
+bool AddressKey::operator!=(const AddressKey &rhs) const noexcept {
+    return !(*this == rhs);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <common/network/HostAddress.hpp>
+
+#include <cstdint>
+
+
+// Fixed-size, inline representation of socket address (IP, port and IPv6 scope),
+// suitable as a hash table key. Unlike HostAddress it does not allocate.
+// IPv4 addresses are stored as IPv4-mapped IPv6 ones.
+class AddressKey final {
+private:
+    uint64_t words[3];  // IPv6 address, then port | scope id | IP version
+
+public:
+    AddressKey() noexcept;
+    explicit AddressKey(const HostAddress::SocketAddress &sock_addr) noexcept;
+
+    uint64_t hash() const noexcept;
+
+    bool operator==(const AddressKey &rhs) const noexcept;
+    bool operator!=(const AddressKey &rhs) const noexcept;
+};
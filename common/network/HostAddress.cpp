@@ -74,6 +74,9 @@ bool HostAddress::resolve(const std::string &host, unsigned short port) {
                    &reinterpret_cast<sockaddr_in6*>(result->ai_addr)->sin6_addr,
                     sizeof(in6_addr));
             addr_ptr->addr_v6.sin6_port = htons(port);
+            // interface of link-local address, e.g. ff02::1%eth0
+            addr_ptr->addr_v6.sin6_scope_id =
+                    reinterpret_cast<sockaddr_in6*>(result->ai_addr)->sin6_scope_id;
         }
     }
 
@@ -114,6 +117,29 @@ std::string HostAddress::to_string() const noexcept {
 }
 
 
+bool HostAddress::is_multicast() const noexcept {
+    assert(addr_ptr != nullptr);
+
+    if (addr_ptr->ip_version == IpVersion::IPv4) {
+        return IN_MULTICAST(ntohl(addr_ptr->addr_v4.sin_addr.s_addr));
+    }
+    return IN6_IS_ADDR_MULTICAST(&addr_ptr->addr_v6.sin6_addr);
+}
+
+
+bool HostAddress::is_same_host(const HostAddress &rhs) const noexcept {
+    assert(addr_ptr != nullptr && rhs.addr_ptr != nullptr);
+
+    if (addr_ptr->ip_version != rhs.addr_ptr->ip_version) {
+        return false;
+    }
+    if (addr_ptr->ip_version == IpVersion::IPv4) {
+        return addr_ptr->addr_v4.sin_addr.s_addr == rhs.addr_ptr->addr_v4.sin_addr.s_addr;
+    }
+    return IN6_ARE_ADDR_EQUAL(&addr_ptr->addr_v6.sin6_addr, &rhs.addr_ptr->addr_v6.sin6_addr);
+}
+
+
 bool HostAddress::operator==(const HostAddress &rhs) const noexcept {
     return compare(rhs) == 0;
 }
@@ -55,6 +55,12 @@ public:
     // returns string representation of address
     // must not be called when get() == nullptr
     std::string to_string() const noexcept;
+    // returns true if address is IPv4 or IPv6 multicast group
+    // must not be called when get() == nullptr
+    bool is_multicast() const noexcept;
+    // returns true if both addresses have the same IP, ports are not compared
+    // must not be called when get() == nullptr
+    bool is_same_host(const HostAddress &rhs) const noexcept;
 
     bool operator==(const HostAddress &rhs) const noexcept;
     bool operator!=(const HostAddress &rhs) const noexcept;
@@ -0,0 +1,80 @@
+#include <common/network/Poller.hpp>
+
+#include <cassert>
+#include <cerrno>
+#include <unistd.h>
+
+
+const uint32_t Poller::readable = EPOLLIN;
+const uint32_t Poller::writable = EPOLLOUT;
+
+
+Poller::~Poller() noexcept {
+    if (epfd >= 0) {
+        close(epfd);
+    }
+}
+
+
+bool Poller::init(std::size_t max_events) noexcept {
+    assert(epfd == -1);
+    assert(max_events > 0);
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        return false;
+    }
+
+    ready_events.resize(max_events);
+    return true;
+}
+
+
+bool Poller::add(int fd, uint32_t interest, uint64_t tag) noexcept {
+    epoll_event ev = {};
+    ev.events = interest;
+    ev.data.u64 = tag;
+
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+
+bool Poller::modify(int fd, uint32_t interest, uint64_t tag) noexcept {
+    epoll_event ev = {};
+    ev.events = interest;
+    ev.data.u64 = tag;
+
+    return epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+
+bool Poller::remove(int fd) noexcept {
+    return epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr) == 0;
+}
+
+
+int Poller::wait(int timeout_ms) noexcept {
+    ready_cnt = epoll_wait(epfd, ready_events.data(), ready_events.size(), timeout_ms);
+    if (ready_cnt < 0) {
+        if (errno == EINTR) {
+            ready_cnt = 0;
+            return 0;
+        }
+
+        return -1;
+    }
+
+    return ready_cnt;
+}
+
+
+uint64_t Poller::ready_tag(int i) const noexcept {
+    assert(0 <= i && i < ready_cnt);
+    return ready_events[i].data.u64;
+}
+
+
+uint32_t Poller::ready_interest(int i) const noexcept {
+    assert(0 <= i && i < ready_cnt);
+    return ready_events[i].events;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <sys/epoll.h>
+
+#include <cstdint>
+#include <vector>
+
+
+// Wrapper for epoll(7) instance. Every registered descriptor has a tag
+// which is reported back by wait() when the descriptor becomes ready.
+class Poller final {
+public:
+    static const uint32_t readable;
+    static const uint32_t writable;
+
+private:
+    int epfd = -1;
+    std::vector<epoll_event> ready_events;
+    int ready_cnt = 0;
+
+public:
+    Poller() noexcept = default;
+    Poller(const Poller &poller) = delete;
+    Poller &operator=(const Poller &poller) = delete;
+    ~Poller() noexcept;
+
+    // max_events is maximum number of descriptors reported by single wait()
+    bool init(std::size_t max_events = 16) noexcept;
+    // interest is a combination of readable and writable
+    bool add(int fd, uint32_t interest, uint64_t tag) noexcept;
+    bool modify(int fd, uint32_t interest, uint64_t tag) noexcept;
+    bool remove(int fd) noexcept;
+
+    // Blocks until at least one descriptor is ready or timeout_ms passes
+    // (negative value means no timeout). Returns number of ready descriptors
+    // or -1 on error. Interrupted wait is not an error and returns 0.
+    int wait(int timeout_ms) noexcept;
+    // i must be smaller than value returned by the last wait()
+    uint64_t ready_tag(int i) const noexcept;
+    uint32_t ready_interest(int i) const noexcept;
+};
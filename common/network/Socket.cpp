@@ -29,6 +29,11 @@ bool Socket::is_blocking() const noexcept {
 }
 
 
+int Socket::get_fd() const noexcept {
+    return sockfd;
+}
+
+
 Socket::Status Socket::get_error_status() const noexcept {
     // Sometimes the same as EAGAIN, and we can not have
     // switch with multiple cases for the same number.
@@ -54,6 +59,14 @@ Socket::Status Socket::get_error_status() const noexcept {
 }
 
 
+Socket::Status Socket::set_reuse_address() const noexcept {
+    assert(sockfd >= 0);
+    int enable = 1;
+    return setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == 0
+           ? Status::Done : Status::Error;
+}
+
+
 Socket::Status Socket::bind(const HostAddress &host_addr) const noexcept {
     assert(sockfd >= 0);
 
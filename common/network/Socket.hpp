@@ -22,6 +22,11 @@ public:
 
     Socket::Status set_blocking(bool block) const noexcept;
     bool is_blocking() const noexcept;
+    // returns underlying descriptor, e.g. for registering it in Poller
+    int get_fd() const noexcept;
+    // allows many sockets to bind the same address, e.g. members of multicast group,
+    // must be called before bind()
+    Socket::Status set_reuse_address() const noexcept;
     // must not be called before init() in derived classes
     Socket::Status bind(const HostAddress& host_addr) const noexcept;
 
@@ -1,10 +1,18 @@
 #include <common/network/TcpSocket.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <netinet/tcp.h>
+#include <sys/uio.h>
 
 
-static constexpr std::size_t chunk_size = 512;
+// Also the maximum length of line (with new line character) in receive_line().
+static constexpr std::size_t recv_ring_capacity = 4096;  // power of two
+// Output queue is kept in chunks, so sent lines can be dropped without moving
+// the rest and one writev(2) call sends up to max_iovecs_cnt of them.
+static constexpr std::size_t send_chunk_capacity = 64 * 1024;
+static constexpr std::size_t max_iovecs_cnt = 16;
 
 
 Socket::Status TcpSocket::init(HostAddress::IpVersion ip_ver) noexcept {
@@ -85,47 +93,126 @@ Socket::Status TcpSocket::receive(std::string &buffer, std::size_t buffer_size)
     }
 }
 
-Socket::Status TcpSocket::send_line(const std::string &data) noexcept {
-    std::size_t sent = 0;
-    Socket::Status status;
+Socket::Status TcpSocket::receive_line(const char *&line, std::size_t &size) noexcept {
+    if (recv_ring.empty()) {
+        recv_ring.resize(recv_ring_capacity);
+        wrapped_line.reserve(recv_ring_capacity);
+    }
+    const auto mask = recv_ring_capacity - 1;
+
+    while (true) {
+        // looking for new line character in not scanned data, in up to two parts
+        while (recv_scanned < recv_end) {
+            auto scan_begin = &recv_ring[recv_scanned & mask];
+            auto scan_size = std::min(recv_end - recv_scanned,
+                                      recv_ring_capacity - (recv_scanned & mask));
+            auto found = static_cast<const char*>(memchr(scan_begin, '\n', scan_size));
+            if (found == nullptr) {
+                recv_scanned += scan_size;
+                continue;
+            }
+
+            auto line_end = recv_scanned + (found - scan_begin);
+            size = line_end - recv_begin;
+            auto offset = recv_begin & mask;
+            if (recv_discarding) {
+                line = wrapped_line.data();
+                size = 0;
+                recv_discarding = false;
+            }
+            else if (offset + size <= recv_ring_capacity) {
+                line = &recv_ring[offset];
+            }
+            else {
+                auto first_part = recv_ring_capacity - offset;
+                wrapped_line.assign(&recv_ring[offset], first_part);
+                wrapped_line.append(&recv_ring[0], size - first_part);
+                line = wrapped_line.data();
+            }
+
+            recv_begin = recv_scanned = line_end + 1;
+            return Status::Done;
+        }
 
-    std::string to_sent = data + "\n";
-    do {
-        status = send(to_sent, sent);
-    } while (status == Status::Partial);
+        if (recv_end - recv_begin == recv_ring_capacity) {
+            // too long line
+            recv_begin = recv_scanned = recv_end;
+            recv_discarding = true;
+        }
 
-    return status;
+        // receiving into free space, in up to two parts
+        iovec iovecs[2];
+        auto free_begin = recv_end & mask;
+        auto free_size = recv_ring_capacity - (recv_end - recv_begin);
+        iovecs[0].iov_base = &recv_ring[free_begin];
+        iovecs[0].iov_len = std::min(free_size, recv_ring_capacity - free_begin);
+        iovecs[1].iov_base = &recv_ring[0];
+        iovecs[1].iov_len = free_size - iovecs[0].iov_len;
+
+        auto received = readv(sockfd, iovecs, iovecs[1].iov_len > 0 ? 2 : 1);
+        if (received == 0) {
+            return Status::Disconnected;
+        }
+        else if (received < 0) {
+            return get_error_status();
+        }
+        recv_end += received;
+    }
+}
+
+
+void TcpSocket::queue_line(const std::string &data) {
+    auto size = data.size() + 1;
+    if (send_chunks.empty() || send_chunks.back().size() + size > send_chunk_capacity) {
+        if (spare_chunks.empty()) {
+            send_chunks.emplace_back();
+            send_chunks.back().reserve(std::max(send_chunk_capacity, size));
+        }
+        else {
+            send_chunks.push_back(std::move(spare_chunks.back()));
+            spare_chunks.pop_back();
+        }
+    }
+
+    auto &chunk = send_chunks.back();
+    chunk.append(data);
+    chunk.push_back('\n');
+    queued_size += size;
 }
 
-Socket::Status TcpSocket::receive_line(std::string &buffer) noexcept {
-    auto status = Status::Done;
-    bool waiting_for_rest_of_command = false;
-    std::string chunk_buffer;
 
-    buffer = recv_buffer;
-    recv_buffer.clear();
-    for (size_t scanned_bytes_cnt = 0;
-         buffer.find('\n', scanned_bytes_cnt) == std::string::npos; ) {
-        scanned_bytes_cnt = buffer.size();
-        status = receive(chunk_buffer, chunk_size);
+Socket::Status TcpSocket::flush() noexcept {
+    while (queued_size > 0) {
+        iovec iovecs[max_iovecs_cnt];
+        std::size_t iovecs_cnt = std::min(send_chunks.size(), max_iovecs_cnt);
+        for (std::size_t i = 0; i < iovecs_cnt; i++) {
+            auto offset = i == 0 ? send_offset : 0;
+            iovecs[i].iov_base = &send_chunks[i][offset];
+            iovecs[i].iov_len = send_chunks[i].size() - offset;
+        }
 
-        if (status != Status::Done) {
-            break;
+        auto result = writev(sockfd, iovecs, iovecs_cnt);
+        if (result < 0) {
+            return get_error_status();
         }
 
-        buffer += chunk_buffer;
-        waiting_for_rest_of_command = true;
+        // dropping sent chunks
+        std::size_t sent = result;
+        queued_size -= sent;
+        while (sent > 0 && sent >= send_chunks.front().size() - send_offset) {
+            sent -= send_chunks.front().size() - send_offset;
+            send_offset = 0;
+            spare_chunks.push_back(std::move(send_chunks.front()));
+            spare_chunks.back().clear();
+            send_chunks.pop_front();
+        }
+        send_offset += sent;
     }
 
-    if (status == Status::Done) {
-        size_t end_offset = buffer.find('\n');
-        recv_buffer = buffer.substr(end_offset + 1);
-        buffer.resize(end_offset);
-    }
-    else if (waiting_for_rest_of_command) {
-        recv_buffer = buffer;
-        buffer.clear();
-    }
+    return Status::Done;
+}
 
-    return status;
+
+std::size_t TcpSocket::get_queued_size() const noexcept {
+    return queued_size;
 }
@@ -2,10 +2,26 @@
 
 #include <common/network/Socket.hpp>
 
+#include <deque>
+#include <string>
+#include <vector>
+
 
 class TcpSocket final : public Socket {
 private:
-    std::string recv_buffer;  // internal buffer for keeping not full line in receive_line()
+    // ring buffer of receive_line(), positions only grow (modulo capacity)
+    std::vector<char> recv_ring;
+    std::size_t recv_begin = 0;    // first byte of the next line
+    std::size_t recv_scanned = 0;  // no new line character before this
+    std::size_t recv_end = 0;      // end of received data
+    bool recv_discarding = false;  // rest of too long line is being dropped
+    std::string wrapped_line;      // for lines wrapping around the ring's end
+
+    // output queue of queue_line(), chunks are reused after being sent
+    std::deque<std::string> send_chunks;
+    std::vector<std::string> spare_chunks;
+    std::size_t send_offset = 0;  // already sent bytes of the first chunk
+    std::size_t queued_size = 0;  // not sent bytes
 
 public:
     TcpSocket() noexcept = default;
@@ -20,8 +36,19 @@ public:
     // buffer will be resized to fit amount of received data.
     Socket::Status receive(std::string &buffer, std::size_t buffer_size) noexcept;
 
-    // Note: You should use only send/receive or only send_line/receive_line!
-    // Note: new line character is being added by send_line and is cut off by receive_line
-    Socket::Status send_line(const std::string &data) noexcept;
-    Socket::Status receive_line(std::string &buffer) noexcept;
+    // Note: You should use only send/receive or only queue_line/receive_line!
+    // Note: new line character is being added by queue_line and is cut off by receive_line
+    // Sets line to the next received line (without new line character), it points
+    // into internal buffer and is valid until the next call. Lines longer than
+    // the buffer are dropped and returned as empty ones.
+    Socket::Status receive_line(const char *&line, std::size_t &size) noexcept;
+
+    // Appends line to the output queue, nothing is sent until flush().
+    void queue_line(const std::string &data);
+    // Sends as much of the output queue as the socket accepts, many lines with
+    // single writev(2). Returns Status::Done if whole queue was sent,
+    // Status::NotReady if the rest has to wait until the socket is writable.
+    Socket::Status flush() noexcept;
+    // Number of queued bytes not sent yet.
+    std::size_t get_queued_size() const noexcept;
 };
@@ -0,0 +1,60 @@
+#include <common/network/Timer.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+
+Timer::~Timer() noexcept {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+
+bool Timer::init() noexcept {
+    assert(fd == -1);
+
+    fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    return fd >= 0;
+}
+
+
+int Timer::get_fd() const noexcept {
+    return fd;
+}
+
+
+bool Timer::arm(system_clock::time_point when) noexcept {
+    using namespace std::chrono;
+
+    if (when == armed_at) {
+        return true;
+    }
+
+    auto since_epoch = duration_cast<nanoseconds>(when.time_since_epoch()).count();
+    itimerspec spec = {};
+    spec.it_value.tv_sec = since_epoch / 1'000'000'000;
+    spec.it_value.tv_nsec = since_epoch % 1'000'000'000;
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+        spec.it_value.tv_nsec = 1;  // zero would disarm the timer
+    }
+
+    if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        return false;
+    }
+
+    armed_at = when;
+    return true;
+}
+
+
+void Timer::consume() noexcept {
+    uint64_t expirations;
+    // Nothing to do on failure: either it was not expired or it was already read.
+    if (read(fd, &expirations, sizeof(expirations)) < 0) {
+        return;
+    }
+    armed_at = system_clock::time_point::min();  // one-shot, disarmed now
+}
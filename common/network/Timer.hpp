@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+
+
+// One-shot timer based on timerfd(2). Its descriptor becomes readable
+// when the system_clock reaches the time point the timer is armed at,
+// so it can be watched together with sockets by the Poller.
+class Timer final {
+public:
+    using system_clock = std::chrono::system_clock;
+
+private:
+    int fd = -1;
+    system_clock::time_point armed_at = system_clock::time_point::min();  // min if not armed
+
+public:
+    Timer() noexcept = default;
+    Timer(const Timer &timer) = delete;
+    Timer &operator=(const Timer &timer) = delete;
+    ~Timer() noexcept;
+
+    bool init() noexcept;
+    int get_fd() const noexcept;
+    // Arms timer at absolute time point. Does nothing if it is already
+    // armed at exactly the same time point and has not expired yet.
+    bool arm(system_clock::time_point when) noexcept;
+    // Clears expiration, so the descriptor is no longer readable
+    // and the timer can be armed again.
+    void consume() noexcept;
+};
@@ -1,9 +1,8 @@
 #include <common/network/UdpSocket.hpp>
 
+#include <algorithm>
 #include <cassert>
-
-
-constexpr std::size_t max_datagram_size = 512;
+#include <netinet/in.h>
 
 
 Socket::Status UdpSocket::init(HostAddress::IpVersion ip_ver) noexcept {
@@ -30,6 +29,28 @@ Socket::Status UdpSocket::send(const std::string &data, const HostAddress &dst_a
 }
 
 
+Socket::Status UdpSocket::join_group(const HostAddress &group) noexcept {
+    auto addr_ptr = group.get();
+    assert(addr_ptr != nullptr && addr_ptr->ip_version == ip_ver);
+
+    int result;
+    if (ip_ver == HostAddress::IpVersion::IPv4) {
+        ip_mreq request = {};
+        request.imr_multiaddr = addr_ptr->addr_v4.sin_addr;
+        request.imr_interface.s_addr = htonl(INADDR_ANY);
+        result = setsockopt(sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request));
+    }
+    else {
+        ipv6_mreq request = {};
+        request.ipv6mr_multiaddr = addr_ptr->addr_v6.sin6_addr;
+        request.ipv6mr_interface = addr_ptr->addr_v6.sin6_scope_id;  // 0 if not given
+        result = setsockopt(sockfd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &request, sizeof(request));
+    }
+
+    return result == 0 ? Status::Done : get_error_status();
+}
+
+
 Socket::Status UdpSocket::receive(std::string &buffer, HostAddress &src_addr) noexcept {
     buffer.resize(max_datagram_size);
     preallocated_sock_addr.clear();
@@ -48,3 +69,197 @@ Socket::Status UdpSocket::receive(std::string &buffer, HostAddress &src_addr) no
 
     return Status::Done;
 }
+
+
+Socket::Status UdpSocket::receive_batch(ReceiveBatch &batch, std::size_t max_cnt) noexcept {
+    max_cnt = std::min(max_cnt, batch.capacity());
+    assert(max_cnt > 0);
+
+    batch.received = 0;
+    for (std::size_t i = 0; i < max_cnt; i++) {
+        auto &addr = batch.addresses[i];
+        addr.clear();
+        addr.ip_version = ip_ver;
+
+        auto &hdr = batch.headers[i].msg_hdr;
+        hdr.msg_name = &addr.addr;
+        hdr.msg_namelen = addr.addrlen;
+        batch.headers[i].msg_len = 0;
+    }
+
+    int cnt = recvmmsg(sockfd, batch.headers.data(), max_cnt, 0, nullptr);
+    if (cnt < 0) {
+        return get_error_status();
+    }
+
+    for (int i = 0; i < cnt; i++) {
+        batch.addresses[i].addrlen = batch.headers[i].msg_hdr.msg_namelen;
+    }
+    batch.received = cnt;
+
+    return cnt > 0 ? Status::Done : Status::NotReady;
+}
+
+
+Socket::Status UdpSocket::send_batch(SendBatch &batch) noexcept {
+    batch.processed = 0;
+    batch.syscalls = 0;
+    std::fill(batch.failed.begin(), batch.failed.end(), false);
+
+    while (batch.processed < batch.used) {
+        int cnt = sendmmsg(sockfd, &batch.headers[batch.processed],
+                           batch.used - batch.processed, 0);
+        batch.syscalls++;
+
+        if (cnt > 0) {
+            batch.processed += cnt;
+            continue;
+        }
+
+        auto status = get_error_status();
+        if (status == Status::NotReady) {
+            return status;
+        }
+
+        // skipping the datagram which can not be sent
+        batch.failed[batch.processed] = true;
+        batch.processed++;
+    }
+
+    return Status::Done;
+}
+
+
+// ------------------------------------------------------------------------------------------------
+//                                   UdpSocket::ReceiveBatch
+// ------------------------------------------------------------------------------------------------
+UdpSocket::ReceiveBatch::ReceiveBatch(std::size_t capacity)
+        : buffers(capacity * max_datagram_size), addresses(capacity),
+          iovecs(capacity), headers(capacity) {
+    assert(capacity > 0);
+
+    for (std::size_t i = 0; i < capacity; i++) {
+        iovecs[i].iov_base = &buffers[i * max_datagram_size];
+        iovecs[i].iov_len = max_datagram_size;
+
+        auto &hdr = headers[i].msg_hdr;
+        hdr = {};
+        hdr.msg_iov = &iovecs[i];
+        hdr.msg_iovlen = 1;
+    }
+}
+
+
+std::size_t UdpSocket::ReceiveBatch::capacity() const noexcept {
+    return headers.size();
+}
+
+
+std::size_t UdpSocket::ReceiveBatch::size() const noexcept {
+    return received;
+}
+
+
+const char *UdpSocket::ReceiveBatch::data(std::size_t i) const noexcept {
+    assert(i < received);
+    return &buffers[i * max_datagram_size];
+}
+
+
+std::size_t UdpSocket::ReceiveBatch::data_size(std::size_t i) const noexcept {
+    assert(i < received);
+    return headers[i].msg_len;
+}
+
+
+const HostAddress::SocketAddress &UdpSocket::ReceiveBatch::address(std::size_t i) const noexcept {
+    assert(i < received);
+    return addresses[i];
+}
+
+
+// ------------------------------------------------------------------------------------------------
+//                                    UdpSocket::SendBatch
+// ------------------------------------------------------------------------------------------------
+UdpSocket::SendBatch::SendBatch(std::size_t capacity)
+        : iovecs(capacity * 2), headers(capacity), failed(capacity) {
+    assert(capacity > 0);
+
+    for (std::size_t i = 0; i < capacity; i++) {
+        auto &hdr = headers[i].msg_hdr;
+        hdr = {};
+        hdr.msg_iov = &iovecs[i * 2];
+        hdr.msg_iovlen = 1;
+    }
+}
+
+
+std::size_t UdpSocket::SendBatch::capacity() const noexcept {
+    return headers.size();
+}
+
+
+std::size_t UdpSocket::SendBatch::size() const noexcept {
+    return used;
+}
+
+
+bool UdpSocket::SendBatch::full() const noexcept {
+    return used == headers.size();
+}
+
+
+void UdpSocket::SendBatch::clear() noexcept {
+    used = processed = syscalls = 0;
+}
+
+
+void UdpSocket::SendBatch::add(const char *data, std::size_t size,
+                               const HostAddress::SocketAddress &dst_addr) noexcept {
+    assert(!full());
+    assert(size <= max_datagram_size);
+
+    iovecs[used * 2].iov_base = const_cast<char*>(data);
+    iovecs[used * 2].iov_len = size;
+
+    auto &hdr = headers[used].msg_hdr;
+    hdr.msg_iovlen = 1;
+    hdr.msg_name = const_cast<sockaddr*>(&dst_addr.addr);
+    hdr.msg_namelen = dst_addr.addrlen;
+    used++;
+}
+
+
+void UdpSocket::SendBatch::add(const char *head, std::size_t head_size,
+                               const char *data, std::size_t size,
+                               const HostAddress::SocketAddress &dst_addr) noexcept {
+    assert(!full());
+    assert(head_size + size <= max_datagram_size);
+
+    iovecs[used * 2].iov_base = const_cast<char*>(head);
+    iovecs[used * 2].iov_len = head_size;
+    iovecs[used * 2 + 1].iov_base = const_cast<char*>(data);
+    iovecs[used * 2 + 1].iov_len = size;
+
+    auto &hdr = headers[used].msg_hdr;
+    hdr.msg_iovlen = 2;
+    hdr.msg_name = const_cast<sockaddr*>(&dst_addr.addr);
+    hdr.msg_namelen = dst_addr.addrlen;
+    used++;
+}
+
+
+std::size_t UdpSocket::SendBatch::processed_cnt() const noexcept {
+    return processed;
+}
+
+
+bool UdpSocket::SendBatch::is_failed(std::size_t i) const noexcept {
+    assert(i < processed);
+    return failed[i];
+}
+
+
+std::size_t UdpSocket::SendBatch::syscalls_cnt() const noexcept {
+    return syscalls;
+}
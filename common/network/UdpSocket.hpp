@@ -1,9 +1,11 @@
 #pragma once
 
 #include <common/network/Socket.hpp>
+#include <common/protocol/utils.hpp>
 
+#include <sys/uio.h>
 
-extern const std::size_t max_datagram_size;
+#include <vector>
 
 
 class UdpSocket final : public Socket {
@@ -16,7 +18,81 @@ public:
 
     Socket::Status init(HostAddress::IpVersion ip_ver) noexcept;
     Socket::Status send(const std::string &data, const HostAddress &dst_addr) noexcept;
+    // Joins multicast group on the interface chosen by the kernel. Datagrams sent
+    // to it are received if the socket is bound to the group's port.
+    Socket::Status join_group(const HostAddress &group) noexcept;
     // buffer will be resized to fit amount of received data.
     // src_addr will be set to data sender.
     Socket::Status receive(std::string &buffer, HostAddress &src_addr) noexcept;
+
+    // Preallocated slots for receiving many datagrams with single system call.
+    // Slots are reused, so received data is valid only until next receive_batch().
+    class ReceiveBatch final {
+    private:
+        std::vector<char> buffers;
+        std::vector<HostAddress::SocketAddress> addresses;
+        std::vector<iovec> iovecs;
+        std::vector<mmsghdr> headers;
+        std::size_t received = 0;
+
+    public:
+        explicit ReceiveBatch(std::size_t capacity);
+
+        std::size_t capacity() const noexcept;
+        // number of datagrams received by last receive_batch()
+        std::size_t size() const noexcept;
+        const char *data(std::size_t i) const noexcept;
+        std::size_t data_size(std::size_t i) const noexcept;
+        const HostAddress::SocketAddress &address(std::size_t i) const noexcept;
+
+        friend class UdpSocket;
+    };
+
+    // Receives up to max_cnt (limited by batch capacity) datagrams with recvmmsg(2).
+    // Returns Status::Done if at least one datagram was received.
+    Socket::Status receive_batch(ReceiveBatch &batch, std::size_t max_cnt) noexcept;
+
+    // Datagrams to be sent with single system call. Batch only points to data
+    // and destination addresses, so they must be valid until send_batch() returns.
+    class SendBatch final {
+    private:
+        std::vector<iovec> iovecs;  // two per datagram
+        std::vector<mmsghdr> headers;
+        std::vector<bool> failed;
+        std::size_t used = 0;
+        std::size_t processed = 0;
+        std::size_t syscalls = 0;
+
+    public:
+        explicit SendBatch(std::size_t capacity);
+
+        std::size_t capacity() const noexcept;
+        std::size_t size() const noexcept;
+        bool full() const noexcept;
+        // removes all datagrams
+        void clear() noexcept;
+        // must not be called on full batch
+        void add(const char *data, std::size_t size,
+                 const HostAddress::SocketAddress &dst_addr) noexcept;
+        // Same as above, but the datagram is gathered from two buffers
+        // (e.g. a header and data which is not copied anywhere).
+        void add(const char *head, std::size_t head_size, const char *data, std::size_t size,
+                 const HostAddress::SocketAddress &dst_addr) noexcept;
+
+        // Following are valid after send_batch():
+        // number of leading datagrams handed to the kernel (or dropped on error)
+        std::size_t processed_cnt() const noexcept;
+        // true if i-th datagram was dropped because of error other than NotReady
+        bool is_failed(std::size_t i) const noexcept;
+        // number of sendmmsg(2) calls made by send_batch()
+        std::size_t syscalls_cnt() const noexcept;
+
+        friend class UdpSocket;
+    };
+
+    // Sends datagrams with sendmmsg(2) in order. Datagrams which can not be sent
+    // because of errors are marked as failed and skipped, like in send() we do not
+    // want a single bad address to block others. Returns Status::NotReady when
+    // socket buffer got full before all datagrams were processed.
+    Socket::Status send_batch(SendBatch &batch) noexcept;
 };
@@ -0,0 +1,254 @@
+#include <common/protocol/DatagramCompression.hpp>
+#include <common/protocol/GameEvent.hpp>
+#include <common/protocol/utils.hpp>
+#include <common/utils.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <endian.h>
+
+
+const uint32_t compressed_datagram_marker = UINT32_MAX;
+constexpr std::size_t DatagramCompressor::max_input_size;
+
+static constexpr auto header_size = sizeof(uint32_t) * 2;  // game_id, marker
+static constexpr std::size_t max_decompressed_size = 64 * 1024;
+// Packs almost as many events as the default level 6, in much shorter time.
+static constexpr auto compression_level = 5;
+
+static const std::string &dictionary();
+static void append_u32(std::string &buffer, uint32_t value);
+
+
+bool is_compressed_datagram(const char *data, std::size_t size) noexcept {
+    return size >= header_size && be32toh(*reinterpret_cast<const uint32_t*>(&data[4]))
+                                  == compressed_datagram_marker;
+}
+
+
+// ------------------------------------------------------------------------------------------------
+//                                     DatagramCompressor
+// ------------------------------------------------------------------------------------------------
+DatagramCompressor::DatagramCompressor() {
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    if (deflateInit(&stream, compression_level) != Z_OK) {
+        exit_with_error("Failed to initialize datagram compression.");
+    }
+}
+
+
+DatagramCompressor::~DatagramCompressor() {
+    deflateEnd(&stream);
+}
+
+
+uint32_t DatagramCompressor::prepare_packet(std::string &datagram, uint32_t game_id,
+                                            const std::string &events) {
+    assert(!events.empty());
+
+    input.clear();
+    input_ends.clear();
+    numbers_ends.clear();
+    append_u32(input, be32toh(*reinterpret_cast<const uint32_t*>(&events[4])));  // first event_no
+    uint32_t numbers_cnt = 0;
+    std::size_t offset = 0;
+    while (offset < events.size() && input.size() < max_input_size) {
+        auto data = &events[offset];
+        auto ev_size = be32toh(*reinterpret_cast<const uint32_t*>(data)) + sizeof(uint32_t) * 2;
+        input.append(data, sizeof(uint32_t));  // len
+        input.append(data + sizeof(uint32_t) * 2,  // skipping event_no and crc32
+                     ev_size - sizeof(uint32_t) * 3);
+        input_ends.push_back(input.size());
+
+        auto type = static_cast<GameEvent::Type>(data[8]);
+        numbers_cnt += GameEvent::numbers_cnt(type, data + 9, ev_size - 13);
+        numbers_ends.push_back(numbers_cnt);
+        offset += ev_size;
+    }
+
+    datagram.clear();
+    datagram.reserve(max_datagram_size);
+    append_u32(datagram, game_id);
+    append_u32(datagram, compressed_datagram_marker);
+    const auto budget = max_datagram_size - header_size;
+
+    // The common case: client is up to date and all new events fit.
+    auto events_cnt = input_ends.size();
+    compress(events_cnt, output, 0, deflateBound(&stream, input.size()));
+    if (output.size() <= budget) {
+        datagram.append(output);
+        return numbers_ends[events_cnt - 1];
+    }
+
+    // Otherwise the number of events is estimated from the compression ratio
+    // of all of them and lowered until they fit. Datagram may end up a few events
+    // short of the optimum, but it takes only a couple of compressions.
+    auto estimated_cnt = events_cnt * budget * 97 / 100 / output.size();
+    events_cnt = std::min(estimated_cnt, events_cnt - 1);
+    while (events_cnt > 0 && !compress(events_cnt, datagram, header_size, budget)) {
+        events_cnt -= std::max<std::size_t>(events_cnt / 16, 1);
+    }
+
+    if (events_cnt == 0) {
+        // even single event is too large, plain datagram will do
+        datagram.resize(sizeof(uint32_t));
+        offset = 0;
+        events_cnt = 0;
+        while (events_cnt < input_ends.size()) {
+            auto ev_size = be32toh(*reinterpret_cast<const uint32_t*>(&events[offset]))
+                           + sizeof(uint32_t) * 2;
+            if (datagram.size() + ev_size > max_datagram_size) {
+                break;
+            }
+            datagram.append(&events[offset], ev_size);
+            offset += ev_size;
+            events_cnt++;
+        }
+        return events_cnt == 0 ? 0 : numbers_ends[events_cnt - 1];
+    }
+
+    return numbers_ends[events_cnt - 1];
+}
+
+
+bool DatagramCompressor::compress(std::size_t events_cnt, std::string &buffer,
+                                  std::size_t offset, std::size_t max_size) {
+    assert(events_cnt > 0);
+    const auto &dict = dictionary();
+    deflateReset(&stream);
+    deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dict.data()), dict.size());
+
+    buffer.resize(offset + max_size);
+    stream.next_in = reinterpret_cast<Bytef*>(&input[0]);
+    stream.avail_in = input_ends[events_cnt - 1];
+    stream.next_out = reinterpret_cast<Bytef*>(&buffer[offset]);
+    stream.avail_out = max_size;
+
+    auto status = deflate(&stream, Z_FINISH);
+    buffer.resize(offset + max_size - stream.avail_out);
+    return status == Z_STREAM_END;
+}
+
+
+// ------------------------------------------------------------------------------------------------
+//                                    DatagramDecompressor
+// ------------------------------------------------------------------------------------------------
+DatagramDecompressor::DatagramDecompressor() {
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+    if (inflateInit(&stream) != Z_OK) {
+        exit_with_error("Failed to initialize datagram decompression.");
+    }
+}
+
+
+DatagramDecompressor::~DatagramDecompressor() {
+    inflateEnd(&stream);
+}
+
+
+bool DatagramDecompressor::decompress(const char *data, std::size_t size, std::string &plain) {
+    if (!is_compressed_datagram(data, size)) {
+        return false;
+    }
+
+    inflateReset(&stream);
+    output.resize(max_decompressed_size);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data + header_size));
+    stream.avail_in = size - header_size;
+    stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+    stream.avail_out = output.size();
+
+    auto status = inflate(&stream, Z_FINISH);
+    if (status == Z_NEED_DICT) {
+        const auto &dict = dictionary();
+        if (inflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dict.data()),
+                                 dict.size()) != Z_OK) {
+            return false;
+        }
+        status = inflate(&stream, Z_FINISH);
+    }
+    if (status != Z_STREAM_END) {
+        return false;
+    }
+    output.resize(output.size() - stream.avail_out);
+
+    // restoring event numbers and checksums
+    if (output.size() < sizeof(uint32_t)) {
+        return false;
+    }
+    auto event_no = be32toh(*reinterpret_cast<const uint32_t*>(&output[0]));
+    plain.assign(data, sizeof(uint32_t));  // game_id
+
+    for (std::size_t offset = sizeof(uint32_t); offset < output.size(); ) {
+        if (output.size() - offset < sizeof(uint32_t) + 1) {
+            return false;
+        }
+        auto len = be32toh(*reinterpret_cast<const uint32_t*>(&output[offset]));
+        if (len < sizeof(uint32_t) + 1 || max_datagram_size < len || output.size() - offset < len) {
+            return false;
+        }
+
+        auto event_offset = plain.size();
+        plain.append(&output[offset], sizeof(uint32_t));  // len
+        append_u32(plain, event_no);
+        plain.append(&output[offset + sizeof(uint32_t)], len - sizeof(uint32_t));  // type, data
+        append_u32(plain, crc32(0, reinterpret_cast<const Bytef*>(&plain[event_offset]),
+                                plain.size() - event_offset));
+
+        auto type = static_cast<GameEvent::Type>(output[offset + sizeof(uint32_t)]);
+        auto numbers_cnt = GameEvent::numbers_cnt(type, &output[offset + sizeof(uint32_t) + 1],
+                                                  len - sizeof(uint32_t) - 1);
+        if (numbers_cnt == 0) {
+            return false;
+        }
+        event_no += numbers_cnt;
+        offset += len;
+    }
+
+    return true;
+}
+
+
+// --------------------------------------- helpers
+static const std::string &dictionary() {
+    // Preset dictionary with events as they look in the compressed stream.
+    // Most common events go last, since the nearest matches are the cheapest:
+    // pixel events of several players with their usual coordinates.
+    static const std::string dict = []() {
+        std::string result;
+        append_u32(result, 1000);  // first_event_no
+
+        auto append_event_head = [&result](uint32_t data_size, GameEvent::Type type) {
+            append_u32(result, sizeof(uint32_t) + 1 + data_size);
+            result.push_back(static_cast<char>(type));
+        };
+        append_event_head(1, GameEvent::Type::PlayerEliminated);
+        result.push_back(1);
+        append_event_head(0, GameEvent::Type::GameOver);
+
+        for (uint32_t round = 0; round < 3; round++) {
+            for (uint8_t player_no = 0; player_no < 8; player_no++) {
+                append_event_head(9, GameEvent::Type::Pixel);
+                result.push_back(static_cast<char>(player_no));
+                append_u32(result, 100 + player_no * 70 + round);
+                append_u32(result, 100 + player_no * 50 + round);
+            }
+        }
+
+        return result;
+    }();
+
+    return dict;
+}
+
+
+static void append_u32(std::string &buffer, uint32_t value) {
+    value = htobe32(value);
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
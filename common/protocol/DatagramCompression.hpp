@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+
+// Compressed variant of MultipleGameEvent datagrams, sent only to clients
+// with HeartBeat::Capability::CompressedDatagrams.
+//
+// After game_id comes compressed_datagram_marker (in place of the first event's
+// len, no event is that long) and zlib stream with preset dictionary of:
+// first_event_no (4 bytes) followed by events without event_no and crc32 fields.
+// Events in a datagram are consecutive (PixelRun takes as many numbers as it has
+// pixels) and their checksums are recomputed by the receiver, zlib's own
+// checksum guards the whole stream.
+extern const uint32_t compressed_datagram_marker;
+
+// Checks only the marker.
+bool is_compressed_datagram(const char *data, std::size_t size) noexcept;
+
+
+class DatagramCompressor final {
+public:
+    // Bounds amount of work per datagram: pixel events take 14 bytes in
+    // the compressed stream and compress to ~4 bytes each, so it is more than
+    // fits into a datagram.
+    static constexpr std::size_t max_input_size = 2560;
+
+private:
+    z_stream stream;
+    std::string input;                    // transformed events
+    std::vector<std::size_t> input_ends;  // of events in input
+    std::vector<uint32_t> numbers_ends;   // event numbers taken up to the event
+    std::string output;                   // for estimations
+
+public:
+    DatagramCompressor();
+    ~DatagramCompressor();
+    DatagramCompressor(const DatagramCompressor &compressor) = delete;
+    DatagramCompressor &operator=(const DatagramCompressor &compressor) = delete;
+
+    // Replaces datagram with compressed one containing as many of given serialized,
+    // consecutive events as fit into max_datagram_size. Falls back to plain format
+    // if not even one event fits. Returns number of event numbers included.
+    uint32_t prepare_packet(std::string &datagram, uint32_t game_id, const std::string &events);
+
+private:
+    // Compresses first events_cnt events of input into buffer at offset,
+    // returns false if they do not fit into max_size bytes.
+    bool compress(std::size_t events_cnt, std::string &buffer,
+                  std::size_t offset, std::size_t max_size);
+};
+
+
+class DatagramDecompressor final {
+private:
+    z_stream stream;
+    std::string output;  // transformed events
+
+public:
+    DatagramDecompressor();
+    ~DatagramDecompressor();
+    DatagramDecompressor(const DatagramDecompressor &decompressor) = delete;
+    DatagramDecompressor &operator=(const DatagramDecompressor &decompressor) = delete;
+
+    // Replaces plain with the plain datagram equivalent to compressed one.
+    // Returns false if compressed datagram is malformed.
+    bool decompress(const char *data, std::size_t size, std::string &plain);
+};
@@ -0,0 +1,175 @@
+#include <common/protocol/DatagramParity.hpp>
+#include <common/protocol/utils.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <endian.h>
+#include <zlib.h>
+
+
+static constexpr std::size_t group_size_limit = 8;  // k fits into a byte, but parity
+                                                    // would be late for the first ones
+const uint32_t parity_datagram_marker = UINT32_MAX - 1;
+const std::size_t max_parity_group_size = group_size_limit;
+
+static constexpr auto marker_offset = sizeof(uint32_t);  // after game_id
+static constexpr auto group_size_offset = marker_offset + sizeof(uint32_t);
+static constexpr auto members_offset = group_size_offset + sizeof(uint8_t);
+static constexpr auto member_entry_size = sizeof(uint16_t) + sizeof(uint32_t);  // size, crc32
+
+static std::size_t header_size(std::size_t group_size) noexcept;
+static uint32_t checksum(const char *data, std::size_t size, uint32_t crc = 0) noexcept;
+static void xor_into(std::string &buffer, std::size_t offset, const char *data, std::size_t size);
+
+
+bool is_parity_datagram(const char *data, std::size_t size) noexcept {
+    return size >= members_offset
+           && be32toh(*reinterpret_cast<const uint32_t*>(&data[marker_offset]))
+              == parity_datagram_marker;
+}
+
+
+// ------------------------------------------------------------------------------------------------
+//                                     ParityEncoder
+// ------------------------------------------------------------------------------------------------
+void ParityEncoder::reset(std::size_t group_size) {
+    assert(group_size <= max_parity_group_size);
+    this->group_size = group_size;
+    members_cnt = 0;
+    datagram.assign(header_size(group_size), '\0');
+}
+
+
+std::size_t ParityEncoder::get_group_size() const noexcept {
+    return group_size;
+}
+
+
+void ParityEncoder::add(uint32_t game_id, const char *head, std::size_t head_size,
+                        const char *data, std::size_t size) {
+    auto header = header_size(group_size);
+    if (group_size == 0 || is_complete() || header + head_size + size > max_datagram_size) {
+        return;
+    }
+
+    if (members_cnt == 0) {
+        *reinterpret_cast<uint32_t*>(&datagram[0]) = htobe32(game_id);
+        *reinterpret_cast<uint32_t*>(&datagram[marker_offset]) = htobe32(parity_datagram_marker);
+        datagram[group_size_offset] = static_cast<char>(group_size);
+    }
+
+    auto entry = &datagram[members_offset + members_cnt * member_entry_size];
+    uint16_t size_be = htobe16(head_size + size);
+    uint32_t crc_be = htobe32(checksum(data, size, checksum(head, head_size)));
+    memcpy(entry, &size_be, sizeof(size_be));
+    memcpy(entry + sizeof(size_be), &crc_be, sizeof(crc_be));
+
+    xor_into(datagram, header, head, head_size);
+    xor_into(datagram, header + head_size, data, size);
+    members_cnt++;
+}
+
+
+void ParityEncoder::add(uint32_t game_id, const std::string &data) {
+    add(game_id, nullptr, 0, data.data(), data.size());
+}
+
+
+bool ParityEncoder::is_complete() const noexcept {
+    return group_size > 0 && members_cnt == group_size;
+}
+
+
+void ParityEncoder::take_datagram(std::string &output) {
+    assert(is_complete());
+    output.swap(datagram);
+    reset(group_size);
+}
+
+
+// ------------------------------------------------------------------------------------------------
+//                                     ParityDecoder
+// ------------------------------------------------------------------------------------------------
+void ParityDecoder::remember(const char *data, std::size_t size) {
+    auto &received = history[next];
+    received.crc = checksum(data, size);
+    received.data.assign(data, size);
+    next = (next + 1) % history_size;
+}
+
+
+bool ParityDecoder::recover(const char *data, std::size_t size, std::string &datagram) {
+    if (!is_parity_datagram(data, size)) {
+        return false;
+    }
+
+    std::size_t group_size = static_cast<uint8_t>(data[group_size_offset]);
+    auto header = header_size(group_size);
+    if (group_size == 0 || max_parity_group_size < group_size || size < header) {
+        return false;
+    }
+
+    std::array<const std::string*, group_size_limit> members{};
+    auto missing = group_size;
+    uint16_t missing_size = 0;
+    uint32_t missing_crc = 0;
+    for (std::size_t i = 0; i < group_size; i++) {
+        auto entry = data + members_offset + i * member_entry_size;
+        auto member_size = be16toh(*reinterpret_cast<const uint16_t*>(entry));
+        auto member_crc = be32toh(*reinterpret_cast<const uint32_t*>(entry + sizeof(uint16_t)));
+        if (size - header < member_size) {
+            return false;
+        }
+
+        for (const auto &received : history) {
+            if (received.crc == member_crc && received.data.size() == member_size) {
+                members[i] = &received.data;
+                break;
+            }
+        }
+
+        if (members[i] == nullptr) {
+            if (missing != group_size) {
+                return false;  // one parity rebuilds only one datagram
+            }
+            missing = i;
+            missing_size = member_size;
+            missing_crc = member_crc;
+        }
+    }
+
+    if (missing == group_size) {
+        return false;  // nothing lost
+    }
+
+    datagram.assign(data + header, size - header);
+    for (std::size_t i = 0; i < group_size; i++) {
+        if (i != missing) {
+            xor_into(datagram, 0, members[i]->data(), members[i]->size());
+        }
+    }
+    datagram.resize(missing_size);
+
+    return checksum(datagram.data(), datagram.size()) == missing_crc;
+}
+
+
+// --------------------------------------- helpers
+static std::size_t header_size(std::size_t group_size) noexcept {
+    return members_offset + group_size * member_entry_size;
+}
+
+
+static uint32_t checksum(const char *data, std::size_t size, uint32_t crc) noexcept {
+    return size == 0 ? crc : crc32(crc, reinterpret_cast<const Bytef*>(data), size);
+}
+
+
+static void xor_into(std::string &buffer, std::size_t offset, const char *data, std::size_t size) {
+    if (buffer.size() < offset + size) {
+        buffer.resize(offset + size, '\0');
+    }
+    for (std::size_t i = 0; i < size; i++) {
+        buffer[offset + i] ^= data[i];
+    }
+}
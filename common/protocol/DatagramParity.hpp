@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+
+// Parity datagrams, sent only to clients asking for them with
+// HeartBeat::parity_group_size (k). After every k event datagrams (a group)
+// server sends their XOR, so client can rebuild one lost datagram of the group
+// right away, instead of waiting until the server notices it by a heartbeat.
+//
+// After game_id comes parity_datagram_marker (in place of the first event's len,
+// like compressed_datagram_marker), k (1 byte), then size (2 bytes) and crc32
+// (4 bytes) of every datagram of the group, and XOR of these datagrams padded
+// with zeros to the longest one. Datagrams too long for the parity datagram
+// to fit into max_datagram_size are not included in any group, these are sent
+// to clients catching up, which do not wait for every single one of them.
+extern const uint32_t parity_datagram_marker;
+extern const std::size_t max_parity_group_size;
+
+// Checks only the marker.
+bool is_parity_datagram(const char *data, std::size_t size) noexcept;
+
+
+class ParityEncoder final {
+private:
+    std::size_t group_size = 0;  // 0 if disabled
+    std::size_t members_cnt = 0;
+    std::string datagram;        // parity of the current group
+
+public:
+    // Starts a new group of given size, 0 disables parity datagrams.
+    void reset(std::size_t group_size);
+    std::size_t get_group_size() const noexcept;
+
+    // Includes datagram (concatenation of head and data) in the current group,
+    // unless it is too long or the group is complete already.
+    void add(uint32_t game_id, const char *head, std::size_t head_size,
+             const char *data, std::size_t size);
+    void add(uint32_t game_id, const std::string &data);
+    bool is_complete() const noexcept;
+    // Replaces output with parity datagram of the complete group
+    // and starts a new group.
+    void take_datagram(std::string &output);
+};
+
+
+class ParityDecoder final {
+private:
+    // Datagrams of a group are sent one after another, followed by the parity.
+    static constexpr std::size_t history_size = 32;
+
+    struct Received {
+        uint32_t crc = 0;
+        std::string data;
+    };
+    std::array<Received, history_size> history;  // ring buffer of the latest datagrams
+    std::size_t next = 0;
+
+public:
+    // Remembers received datagram, it may belong to a group.
+    void remember(const char *data, std::size_t size);
+    // Replaces datagram with the only one from parity datagram's group which
+    // was not remembered. Returns false if there is no such datagram (nothing
+    // or too much was lost) or parity datagram is malformed.
+    bool recover(const char *data, std::size_t size, std::string &datagram);
+};
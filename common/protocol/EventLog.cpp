@@ -0,0 +1,270 @@
+#include <common/protocol/EventLog.hpp>
+#include <common/protocol/utils.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <endian.h>
+#include <zlib.h>
+
+
+const std::size_t EventLog::chunk_size = 1 << 20;
+
+static const std::size_t event_header_size =
+        sizeof(uint32_t)     // len
+        + sizeof(uint32_t)   // event_no
+        + sizeof(uint8_t);   // type
+static const std::size_t event_overhead_size = event_header_size + sizeof(uint32_t);  // crc32
+
+// Single pixel is smaller as Pixel event.
+static constexpr uint32_t min_pixel_run_length = 2;
+
+
+void EventLog::clear() noexcept {
+    offsets.clear();
+    end_offset = 0;
+}
+
+
+uint32_t EventLog::size() const noexcept {
+    return offsets.size();
+}
+
+
+void EventLog::append_new_game(uint32_t maxx, uint32_t maxy,
+                               const std::vector<std::string> &players_names) {
+    std::size_t data_size = sizeof(uint32_t) * 2;
+    for (const auto &name : players_names) {
+        data_size += name.size() + 1;
+    }
+
+    auto it = begin_event(GameEvent::Type::NewGame, data_size);
+    *reinterpret_cast<uint32_t*>(it) = htobe32(maxx);
+    *reinterpret_cast<uint32_t*>(it + 4) = htobe32(maxy);
+    it += 8;
+    for (const auto &name : players_names) {
+        memcpy(it, name.data(), name.size());
+        it += name.size();
+        *it++ = '\0';
+    }
+    finish_event();
+}
+
+
+void EventLog::append_pixel(uint8_t player_no, uint32_t x, uint32_t y) {
+    auto it = begin_event(GameEvent::Type::Pixel, 9);
+    *reinterpret_cast<uint8_t*>(it) = player_no;
+    *reinterpret_cast<uint32_t*>(it + 1) = htobe32(x);
+    *reinterpret_cast<uint32_t*>(it + 5) = htobe32(y);
+    finish_event();
+}
+
+
+void EventLog::append_player_eliminated(uint8_t player_no) {
+    auto it = begin_event(GameEvent::Type::PlayerEliminated, 1);
+    *reinterpret_cast<uint8_t*>(it) = player_no;
+    finish_event();
+}
+
+
+void EventLog::append_game_over() {
+    begin_event(GameEvent::Type::GameOver, 0);
+    finish_event();
+}
+
+
+const char *EventLog::event_data(uint32_t event_no) const noexcept {
+    assert(event_no < size());
+    return at(offsets[event_no]);
+}
+
+
+std::size_t EventLog::event_size(uint32_t event_no) const noexcept {
+    auto len = be32toh(*reinterpret_cast<const uint32_t*>(event_data(event_no)));
+    return len + sizeof(uint32_t) * 2;  // + len + crc32
+}
+
+
+uint32_t EventLog::copy_events(std::string &buffer, uint32_t first_no,
+                               std::size_t max_size) const {
+    auto no = first_no;
+    while (no < size()) {
+        // events of single chunk lie one after another
+        auto chunk_no = offsets[no] / chunk_size;
+        auto range_begin = offsets[no];
+        auto range_end = range_begin;
+        bool fits = true;
+
+        for (; no < size() && offsets[no] / chunk_size == chunk_no; no++) {
+            auto ev_size = event_size(no);
+            if (buffer.size() + (range_end - range_begin) + ev_size > max_size) {
+                fits = false;
+                break;
+            }
+            range_end += ev_size;
+        }
+
+        buffer.append(at(range_begin), range_end - range_begin);
+        if (!fits) {
+            break;
+        }
+    }
+
+    return no;
+}
+
+
+uint32_t EventLog::copy_events_with_pixel_runs(std::string &buffer, uint32_t first_no,
+                                               std::size_t max_size) const {
+    using PixelRunData = GameEvent::PixelRunData;
+    struct RunPlayer {
+        uint8_t player_no;
+        uint32_t start_x, start_y;
+        uint32_t x, y;  // of the last pixel
+    };
+    RunPlayer players[PixelRunData::max_players_cnt];
+
+    auto is_pixel = [this](uint32_t no) {
+        return static_cast<GameEvent::Type>(event_data(no)[8]) == GameEvent::Type::Pixel;
+    };
+    auto read_pixel = [this](uint32_t no, uint8_t &player_no, uint32_t &x, uint32_t &y) {
+        auto data = event_data(no) + event_header_size;
+        player_no = *reinterpret_cast<const uint8_t*>(data);
+        x = be32toh(*reinterpret_cast<const uint32_t*>(data + 1));
+        y = be32toh(*reinterpret_cast<const uint32_t*>(data + 5));
+    };
+
+    auto no = first_no;
+    while (no < size() && buffer.size() < max_size) {
+        // every event has to fit into a datagram on its own
+        auto space = std::min(max_size - buffer.size(),
+                              max_datagram_size - sizeof(uint32_t));  // - game_id
+
+        // find the longest run starting with this event
+        std::size_t players_cnt = 0;
+        auto run_size = event_overhead_size + 1;
+        auto run_end = no;
+        for (; run_end < size() && is_pixel(run_end); run_end++) {
+            uint8_t player_no;
+            uint32_t x, y;
+            read_pixel(run_end, player_no, x, y);
+
+            auto player = std::find_if(players, players + players_cnt,
+                                       [player_no](const auto &run_player) {
+                return run_player.player_no == player_no;
+            });
+            if (player == players + players_cnt) {
+                if (players_cnt == PixelRunData::max_players_cnt
+                        || run_size + PixelRunData::start_size + 1 > space) {
+                    break;
+                }
+                *player = {player_no, x, y, x, y};
+                players_cnt++;
+                run_size += PixelRunData::start_size + 1;
+            }
+            else {
+                if (PixelRunData::step_code(player->x, player->y, x, y) == -1
+                        || run_size + 1 > space) {
+                    break;
+                }
+                player->x = x;
+                player->y = y;
+                run_size++;
+            }
+        }
+
+        if (run_end - no < min_pixel_run_length) {
+            auto ev_size = event_size(no);
+            if (ev_size > space) {
+                break;
+            }
+            buffer.append(event_data(no), ev_size);
+            no++;
+            continue;
+        }
+
+        // encode it
+        auto ev_offset = buffer.size();
+        buffer.resize(ev_offset + run_size);
+        auto it = &buffer[ev_offset];
+        uint32_t len = run_size - sizeof(uint32_t) * 2;  // without len and crc32 fields
+        *reinterpret_cast<uint32_t*>(it) = htobe32(len);
+        *reinterpret_cast<uint32_t*>(it + 4) = htobe32(no);
+        *reinterpret_cast<uint8_t*>(it + 8) = static_cast<uint8_t>(GameEvent::Type::PixelRun);
+        it += event_header_size;
+
+        *reinterpret_cast<uint8_t*>(it++) = players_cnt;
+        for (std::size_t i = 0; i < players_cnt; i++) {
+            auto &player = players[i];
+            *reinterpret_cast<uint8_t*>(it) = player.player_no;
+            *reinterpret_cast<uint32_t*>(it + 1) = htobe32(player.start_x);
+            *reinterpret_cast<uint32_t*>(it + 5) = htobe32(player.start_y);
+            it += PixelRunData::start_size;
+            player.x = player.start_x;
+            player.y = player.start_y;
+        }
+
+        bool started[PixelRunData::max_players_cnt] = {};
+        for (; no < run_end; no++) {
+            uint8_t player_no;
+            uint32_t x, y;
+            read_pixel(no, player_no, x, y);
+            std::size_t index = std::find_if(players, players + players_cnt,
+                                             [player_no](const auto &run_player) {
+                return run_player.player_no == player_no;
+            }) - players;
+
+            auto &player = players[index];
+            auto code = started[index] ? PixelRunData::step_code(player.x, player.y, x, y) : 0;
+            started[index] = true;
+            player.x = x;
+            player.y = y;
+            *it++ = static_cast<char>(index << 3 | code);
+        }
+
+        auto crc_offset = run_size - sizeof(uint32_t);
+        const uint32_t crc32_value = crc32(0, reinterpret_cast<const Bytef*>(&buffer[ev_offset]),
+                                           crc_offset);
+        *reinterpret_cast<uint32_t*>(&buffer[ev_offset + crc_offset]) = htobe32(crc32_value);
+    }
+
+    return no;
+}
+
+
+char *EventLog::begin_event(GameEvent::Type type, std::size_t data_size) {
+    auto ev_size = event_overhead_size + data_size;
+    assert(ev_size <= chunk_size);
+
+    if (end_offset % chunk_size + ev_size > chunk_size) {
+        end_offset += chunk_size - end_offset % chunk_size;  // tail is left unused
+    }
+    if (end_offset / chunk_size == chunks.size()) {
+        chunks.emplace_back(new char[chunk_size]);
+    }
+
+    auto event_no = size();
+    offsets.push_back(end_offset);
+    auto it = at(end_offset);
+    end_offset += ev_size;
+
+    uint32_t len = ev_size - sizeof(uint32_t) * 2;  // without len and crc32 fields
+    *reinterpret_cast<uint32_t*>(it) = htobe32(len);
+    *reinterpret_cast<uint32_t*>(it + 4) = htobe32(event_no);
+    *reinterpret_cast<uint8_t*>(it + 8) = static_cast<uint8_t>(type);
+
+    return it + event_header_size;
+}
+
+
+void EventLog::finish_event() noexcept {
+    auto it = at(offsets.back());
+    auto crc_offset = event_size(offsets.size() - 1) - sizeof(uint32_t);
+    const uint32_t crc32_value = crc32(0, reinterpret_cast<const Bytef*>(it), crc_offset);
+    *reinterpret_cast<uint32_t*>(it + crc_offset) = htobe32(crc32_value);
+}
+
+
+char *EventLog::at(uint64_t offset) const noexcept {
+    return chunks[offset / chunk_size].get() + offset % chunk_size;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <common/protocol/GameEvent.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Append-only log of game events serialized in GameEvent::Format::Binary.
+// Events are encoded straight into large chunks of memory (an event never spans
+// two chunks) and found by offset index, so appending does not allocate except
+// for growing the log. clear() keeps the memory for the next game.
+class EventLog final {
+private:
+    static const std::size_t chunk_size;
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    std::vector<uint64_t> offsets;  // of each event, chunk number * chunk_size + offset
+    uint64_t end_offset = 0;        // where the next event goes
+
+public:
+    EventLog() noexcept = default;
+    EventLog(const EventLog &log) = delete;
+    EventLog &operator=(const EventLog &log) = delete;
+
+    // Removes all events, memory is kept.
+    void clear() noexcept;
+    // Number of events, also number of the next appended event.
+    uint32_t size() const noexcept;
+
+    // Append functions encode the event with next event number. Arguments must
+    // form a valid event (names must fit into NewGame event, see NewGameData).
+    void append_new_game(uint32_t maxx, uint32_t maxy,
+                         const std::vector<std::string> &players_names);
+    void append_pixel(uint8_t player_no, uint32_t x, uint32_t y);
+    void append_player_eliminated(uint8_t player_no);
+    void append_game_over();
+
+    const char *event_data(uint32_t event_no) const noexcept;
+    std::size_t event_size(uint32_t event_no) const noexcept;
+
+    // Appends events starting with first_no to buffer, as long as it does not
+    // exceed max_size. Contiguous ranges of events are copied at once.
+    // Returns number of the first event which was not copied.
+    uint32_t copy_events(std::string &buffer, uint32_t first_no,
+                         std::size_t max_size) const;
+    // Same as above, but consecutive Pixel events are put into PixelRun events
+    // (as long as their pixels form paths and every run fits into a datagram).
+    uint32_t copy_events_with_pixel_runs(std::string &buffer, uint32_t first_no,
+                                         std::size_t max_size) const;
+
+private:
+    // Reserves space for event with data_size bytes of type specific data,
+    // fills len, event_no and type fields and returns pointer to the data field.
+    char *begin_event(GameEvent::Type type, std::size_t data_size);
+    // Fills crc32 of the last event.
+    void finish_event() noexcept;
+    char *at(uint64_t offset) const noexcept;
+};
@@ -1,6 +1,5 @@
 #include <common/protocol/GameEvent.hpp>
 #include <common/protocol/utils.hpp>
-#include <common/network/UdpSocket.hpp>
 #include <common/utils.hpp>
 
 #include <algorithm>
@@ -76,6 +75,16 @@ GameEvent::DeserializationResult GameEvent::deserialize(GameEvent::Format fmt,
         case Type::GameOver:
             break;
 
+        case Type::Snapshot:
+            success = snapshot_data.deserialize_binary(
+                    data, event_offset + type_data_offset, len - type_data_offset);
+            break;
+
+        case Type::PixelRun:
+            success = pixel_run_data.deserialize_binary(
+                    data, event_offset + type_data_offset, len - type_data_offset);
+            break;
+
         default:
             return DeserializationResult::UnknownEventType;
             break;
@@ -93,11 +102,19 @@ bool GameEvent::validate(GameEvent::Format fmt) const noexcept {
         case Type::PlayerEliminated:
                              return player_eliminated_data.validate(fmt);
         case Type::GameOver: return fmt == Format::Binary;
+        case Type::Snapshot: return snapshot_data.validate(fmt);
+        case Type::PixelRun: return pixel_run_data.validate(fmt);
         default:             return false;
     }
 }
 
 
+uint32_t GameEvent::numbers_cnt(GameEvent::Type type, const char *data,
+                                std::size_t size) noexcept {
+    return type == Type::PixelRun ? PixelRunData::pixels_cnt(data, size) : 1;
+}
+
+
 std::string GameEvent::serialize_binary() const noexcept {
     std::string buffer(max_datagram_size, '\0');
 
@@ -122,6 +139,14 @@ std::string GameEvent::serialize_binary() const noexcept {
 
         case Type::GameOver:
             break;
+
+        case Type::Snapshot:
+            len += snapshot_data.serialize_binary(buffer, data_field_offset);
+            break;
+
+        case Type::PixelRun:
+            len += pixel_run_data.serialize_binary(buffer, data_field_offset);
+            break;
     }
 
     *reinterpret_cast<uint32_t*>(&buffer[0]) = htobe32(len);
@@ -323,3 +348,206 @@ bool GameEvent::PlayerEliminatedData::validate(GameEvent::Format fmt) const  noe
 
     return true;
 }
+
+
+// ------------------------------------------------------------------------------------------------
+//                                    GameEvent::SnapshotData
+// ------------------------------------------------------------------------------------------------
+const std::size_t GameEvent::SnapshotData::fragment_capacity =
+        max_datagram_size - (
+                sizeof(uint32_t)                 // game_id
+                + min_size_of_binary_packet  // len, event_no, type, crc32
+                + sizeof(uint16_t) * 2           // fragment_{no,cnt}
+);
+
+
+std::size_t GameEvent::SnapshotData::serialize_binary(
+        std::string &buf, std::size_t offset) const noexcept {
+    char *const buf_ptr = &buf[offset];
+    *reinterpret_cast<uint16_t*>(buf_ptr) = htobe16(fragment_no);
+    *reinterpret_cast<uint16_t*>(buf_ptr + 2) = htobe16(fragments_cnt);
+    memcpy(buf_ptr + 4, fragment.data(), fragment.size());
+
+    return 4 + fragment.size();
+}
+
+
+bool GameEvent::SnapshotData::deserialize_binary(
+        const std::string &data, std::size_t offset, std::size_t size) noexcept {
+    assert(offset + size <= data.length());
+    if (size < 4) {
+        return false;
+    }
+
+    const char *const data_ptr = &data[offset];
+    fragment_no = be16toh(*reinterpret_cast<const uint16_t*>(data_ptr));
+    fragments_cnt = be16toh(*reinterpret_cast<const uint16_t*>(data_ptr + 2));
+    fragment.assign(data_ptr + 4, size - 4);
+
+    return true;
+}
+
+
+bool GameEvent::SnapshotData::validate(GameEvent::Format fmt) const noexcept {
+    return fmt == Format::Binary && fragment_no < fragments_cnt
+           && !fragment.empty() && fragment.size() <= fragment_capacity;
+}
+
+
+// ------------------------------------------------------------------------------------------------
+//                                    GameEvent::PixelRunData
+// ------------------------------------------------------------------------------------------------
+constexpr std::size_t GameEvent::PixelRunData::max_players_cnt;
+constexpr std::size_t GameEvent::PixelRunData::start_size;
+const int8_t GameEvent::PixelRunData::steps[8][2] = {
+        {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1},
+};
+
+
+int GameEvent::PixelRunData::step_code(uint32_t x, uint32_t y,
+                                       uint32_t new_x, uint32_t new_y) noexcept {
+    // codes by (dx + 1) * 3 + (dy + 1)
+    static const int8_t codes[9] = {5, 4, 3, 6, -1, 2, 7, 0, 1};
+    auto dx = static_cast<int64_t>(new_x) - x;
+    auto dy = static_cast<int64_t>(new_y) - y;
+    if (dx < -1 || 1 < dx || dy < -1 || 1 < dy) {
+        return -1;
+    }
+
+    return codes[(dx + 1) * 3 + (dy + 1)];
+}
+
+
+std::size_t GameEvent::PixelRunData::pixels_cnt(const char *data, std::size_t size) noexcept {
+    if (size < 1) {
+        return 0;
+    }
+
+    std::size_t players_cnt = *reinterpret_cast<const uint8_t*>(data);
+    std::size_t header_size = 1 + players_cnt * start_size;
+    if (players_cnt == 0 || max_players_cnt < players_cnt || size <= header_size) {
+        return 0;
+    }
+
+    return size - header_size;
+}
+
+
+std::size_t GameEvent::PixelRunData::serialize_binary(
+        std::string &buf, std::size_t offset) const noexcept {
+    struct Start {
+        uint8_t player_no;
+        uint32_t x, y;  // of the last pixel
+    };
+    Start starts[max_players_cnt];
+    std::size_t players_cnt = 0;
+
+    auto entries = &buf[offset + 1];
+    for (const auto &pixel : pixels) {
+        auto it = std::find_if(starts, starts + players_cnt, [&pixel](const auto &start) {
+            return start.player_no == pixel.player_no;
+        });
+        uint8_t code = 0;
+        if (it == starts + players_cnt) {
+            *it = {pixel.player_no, pixel.x, pixel.y};
+            players_cnt++;
+        }
+        else {
+            code = step_code(it->x, it->y, pixel.x, pixel.y);
+            it->x = pixel.x;
+            it->y = pixel.y;
+        }
+        *entries++ = static_cast<char>((it - starts) << 3 | code);
+    }
+
+    // starts go before entries, making room for them
+    auto starts_size = players_cnt * start_size;
+    memmove(&buf[offset + 1 + starts_size], &buf[offset + 1], pixels.size());
+    *reinterpret_cast<uint8_t*>(&buf[offset]) = players_cnt;
+    for (std::size_t i = 0; i < players_cnt; i++) {
+        auto first = std::find_if(pixels.begin(), pixels.end(), [&](const auto &pixel) {
+            return pixel.player_no == starts[i].player_no;
+        });
+        auto start_ptr = &buf[offset + 1 + i * start_size];
+        *reinterpret_cast<uint8_t*>(start_ptr) = first->player_no;
+        *reinterpret_cast<uint32_t*>(start_ptr + 1) = htobe32(first->x);
+        *reinterpret_cast<uint32_t*>(start_ptr + 5) = htobe32(first->y);
+    }
+
+    return 1 + starts_size + pixels.size();
+}
+
+
+bool GameEvent::PixelRunData::deserialize_binary(
+        const std::string &data, std::size_t offset, std::size_t size) noexcept {
+    assert(offset + size <= data.length());
+    const char *const data_ptr = &data[offset];
+    auto cnt = pixels_cnt(data_ptr, size);
+    if (cnt == 0) {
+        return false;
+    }
+
+    std::size_t players_cnt = *reinterpret_cast<const uint8_t*>(data_ptr);
+    PixelData last[max_players_cnt];
+    bool started[max_players_cnt] = {};
+    for (std::size_t i = 0; i < players_cnt; i++) {
+        auto start_ptr = data_ptr + 1 + i * start_size;
+        last[i].player_no = *reinterpret_cast<const uint8_t*>(start_ptr);
+        last[i].x = be32toh(*reinterpret_cast<const uint32_t*>(start_ptr + 1));
+        last[i].y = be32toh(*reinterpret_cast<const uint32_t*>(start_ptr + 5));
+    }
+
+    pixels.resize(cnt);
+    auto entries = reinterpret_cast<const uint8_t*>(data_ptr + 1 + players_cnt * start_size);
+    for (std::size_t i = 0; i < cnt; i++) {
+        std::size_t index = entries[i] >> 3;
+        auto code = entries[i] & 7;
+        if (index >= players_cnt) {
+            return false;
+        }
+
+        auto &pixel = last[index];
+        if (!started[index]) {
+            if (code != 0) {
+                return false;
+            }
+            started[index] = true;
+        }
+        else {
+            pixel.x += steps[code][0];
+            pixel.y += steps[code][1];
+        }
+        pixels[i] = pixel;
+    }
+
+    return true;
+}
+
+
+bool GameEvent::PixelRunData::validate(GameEvent::Format fmt) const noexcept {
+    if (fmt != Format::Binary || pixels.empty()) {
+        return false;
+    }
+
+    // every player's pixels must form a path of neighbours
+    PixelData last[max_players_cnt];
+    std::size_t players_cnt = 0;
+    for (const auto &pixel : pixels) {
+        auto it = std::find_if(last, last + players_cnt, [&pixel](const auto &last_pixel) {
+            return last_pixel.player_no == pixel.player_no;
+        });
+        if (it == last + players_cnt) {
+            if (players_cnt == max_players_cnt) {
+                return false;
+            }
+            players_cnt++;
+        }
+        else if (step_code(it->x, it->y, pixel.x, pixel.y) == -1) {
+            return false;
+        }
+        *it = pixel;
+    }
+
+    return 1 + players_cnt * start_size + pixels.size() + min_size_of_binary_packet
+           <= max_datagram_size;
+}
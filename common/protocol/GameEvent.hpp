@@ -21,6 +21,8 @@ public:
         Pixel = 1,
         PlayerEliminated = 2,
         GameOver = 3,
+        Snapshot = 4,  // only for clients with HeartBeat::Capability::Snapshots
+        PixelRun = 5,  // only for clients with HeartBeat::Capability::PixelRuns
     };
 
     enum class Format {
@@ -78,12 +80,58 @@ public:
         friend class GameEvent;
     };
 
+    // Fragment of compressed MapSnapshot of events [0, event_no), only in Format::Binary.
+    // Client which collected all fragments continues with event event_no.
+    struct SnapshotData final {
+        uint16_t fragment_no = 0;
+        uint16_t fragments_cnt = 0;
+        std::string fragment;
+
+        // Bytes of compressed snapshot which fit into a single datagram fragment.
+        static const std::size_t fragment_capacity;
+
+    private:
+        std::size_t serialize_binary(std::string &buf, std::size_t offset) const noexcept;
+        bool deserialize_binary(const std::string &data,
+                                std::size_t offset, std::size_t size) noexcept;
+        bool validate(Format fmt) const noexcept;
+        friend class GameEvent;
+    };
+
+    // Pixel events [event_no, event_no + pixels.size()), only in Format::Binary.
+    // Serialized as players_cnt (1 byte), starting pixel of every player in run
+    // (player_no, x, y) and one byte per pixel: index of player's start (5 bits)
+    // and code of 8-neighbour step from player's previous pixel (3 bits),
+    // which is 0 for the starting pixel itself.
+    struct PixelRunData final {
+        std::vector<PixelData> pixels;  // without player_name
+
+        static constexpr std::size_t max_players_cnt = 32;  // 5 bits of index
+        static constexpr std::size_t start_size = 9;        // of serialized player's start
+        static const int8_t steps[8][2];  // (dx, dy) of step codes, clockwise from the right
+
+        // Returns code of step between neighbour pixels or -1 if they are not
+        // 8-neighbours.
+        static int step_code(uint32_t x, uint32_t y, uint32_t new_x, uint32_t new_y) noexcept;
+        // Number of pixels in serialized data, 0 if it is malformed.
+        static std::size_t pixels_cnt(const char *data, std::size_t size) noexcept;
+
+    private:
+        std::size_t serialize_binary(std::string &buf, std::size_t offset) const noexcept;
+        bool deserialize_binary(const std::string &data,
+                                std::size_t offset, std::size_t size) noexcept;
+        bool validate(Format fmt) const noexcept;
+        friend class GameEvent;
+    };
+
     uint32_t event_no = 0;
     Type type = Type::NewGame;
     // Can not be in union, because they contain C++ objects with internal states.
     NewGameData new_game_data;
     PixelData pixel_data;
     PlayerEliminatedData player_eliminated_data;
+    SnapshotData snapshot_data;
+    PixelRunData pixel_run_data;
 
     // Prepares proper packet. Must be called on valid struct.
     std::string serialize(Format fmt) const noexcept;
@@ -93,6 +141,10 @@ public:
     // Check if fields contain valid values.
     bool validate(Format fmt) const noexcept;
 
+    // Number of event numbers taken by binary event with given type specific data:
+    // number of pixels for PixelRun, 1 for other types. Returns 0 if data is malformed.
+    static uint32_t numbers_cnt(Type type, const char *data, std::size_t size) noexcept;
+
 private:
     std::string serialize_binary() const noexcept;
     std::string serialize_text() const noexcept;
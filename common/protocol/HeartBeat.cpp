@@ -2,12 +2,33 @@
 #include <common/protocol/utils.hpp>
 
 #include <cassert>
+#include <climits>
 #include <cstring>
 #include <endian.h>
 
 
 static constexpr auto header_size = sizeof(uint64_t) + sizeof(int8_t) + sizeof(uint32_t);
 
+// extensions
+static constexpr auto max_extensions_size = 64;  // including the leading null byte
+static constexpr auto extension_header_size = 2;  // type, length
+
+enum class ExtensionType : uint8_t {
+    Capabilities = 1,
+    NextExpectedFragmentNo = 2,
+    ReceivedEvents = 3,  // bitmap, least significant bit of the first byte goes first
+    ParityGroupSize = 4,
+};
+static_assert(1 + 3 * (extension_header_size + sizeof(uint32_t))
+              + extension_header_size + HeartBeat::max_received_events / CHAR_BIT
+              <= max_extensions_size, "all extensions have to fit, also for older servers");
+
+static void append_extension(std::string &buffer, ExtensionType type, uint32_t value);
+static void append_bitmap_extension(std::string &buffer, ExtensionType type,
+                                    const std::bitset<HeartBeat::max_received_events> &bits);
+static void read_bitmap(const char *data, std::size_t size,
+                        std::bitset<HeartBeat::max_received_events> &bits) noexcept;
+
 
 std::string HeartBeat::serialize() const noexcept {
     assert(validate());
@@ -18,12 +39,35 @@ std::string HeartBeat::serialize() const noexcept {
     *reinterpret_cast<uint32_t*>(&buffer[9]) = htobe32(next_expected_event_no);
     memcpy(&buffer[13], &player_name[0], player_name.size());
 
+    if (capabilities != 0 || next_expected_fragment_no != 0 || received_events.any()
+            || parity_group_size != 0) {
+        buffer.push_back('\0');
+        if (capabilities != 0) {
+            append_extension(buffer, ExtensionType::Capabilities, capabilities);
+        }
+        if (next_expected_fragment_no != 0) {
+            append_extension(buffer, ExtensionType::NextExpectedFragmentNo,
+                             next_expected_fragment_no);
+        }
+        if (received_events.any()) {
+            append_bitmap_extension(buffer, ExtensionType::ReceivedEvents, received_events);
+        }
+        if (parity_group_size != 0) {
+            append_extension(buffer, ExtensionType::ParityGroupSize, parity_group_size);
+        }
+    }
+
     return buffer;
 }
 
 
 bool HeartBeat::deserialize(const std::string &data) noexcept {
-    if (data.length() < header_size || header_size + max_player_name_length < data.length()) {
+    return deserialize(data.data(), data.size());
+}
+
+
+bool HeartBeat::deserialize(const char *data, std::size_t size) noexcept {
+    if (size < header_size || header_size + max_player_name_length + max_extensions_size < size) {
         return false;
     }
 
@@ -31,9 +75,44 @@ bool HeartBeat::deserialize(const std::string &data) noexcept {
     turn_direction = *reinterpret_cast<const uint8_t*>(&data[8]);
     next_expected_event_no = be32toh(*reinterpret_cast<const uint32_t*>(&data[9]));
 
-    auto player_name_length = data.length() - header_size;
-    player_name.resize(player_name_length);
-    memcpy(&player_name[0], &data[13], player_name_length);
+    auto name_end = static_cast<const char*>(memchr(&data[13], '\0', size - header_size));
+    auto player_name_length = (name_end != nullptr ? name_end : data + size) - &data[13];
+    player_name.assign(&data[13], player_name_length);
+
+    capabilities = 0;
+    next_expected_fragment_no = 0;
+    received_events.reset();
+    parity_group_size = 0;
+    if (name_end != nullptr) {
+        auto it = name_end + 1;
+        auto const data_end = data + size;
+        while (it < data_end) {
+            if (data_end - it < extension_header_size
+                    || data_end - it - extension_header_size < static_cast<uint8_t>(it[1])) {
+                return false;
+            }
+
+            auto type = static_cast<ExtensionType>(it[0]);
+            auto length = static_cast<uint8_t>(it[1]);
+            auto value = it + extension_header_size;
+            bool is_number = length == sizeof(uint32_t);
+            if (type == ExtensionType::Capabilities && is_number) {
+                capabilities = be32toh(*reinterpret_cast<const uint32_t*>(value));
+            }
+            else if (type == ExtensionType::NextExpectedFragmentNo && is_number) {
+                next_expected_fragment_no = be32toh(*reinterpret_cast<const uint32_t*>(value));
+            }
+            else if (type == ExtensionType::ReceivedEvents
+                     && length <= max_received_events / CHAR_BIT) {
+                read_bitmap(value, length, received_events);
+            }
+            else if (type == ExtensionType::ParityGroupSize && is_number) {
+                parity_group_size = be32toh(*reinterpret_cast<const uint32_t*>(value));
+            }
+
+            it = value + length;
+        }
+    }
 
     return validate();
 }
@@ -46,3 +125,39 @@ bool HeartBeat::validate() const noexcept {
 
     return validate_player_name(player_name);
 }
+
+
+// --------------------------------------- helpers
+static void append_extension(std::string &buffer, ExtensionType type, uint32_t value) {
+    char entry[extension_header_size + sizeof(value)];
+    entry[0] = static_cast<char>(type);
+    entry[1] = sizeof(value);
+    value = htobe32(value);
+    memcpy(&entry[2], &value, sizeof(value));
+    buffer.append(entry, sizeof(entry));
+}
+
+
+static void append_bitmap_extension(std::string &buffer, ExtensionType type,
+                                    const std::bitset<HeartBeat::max_received_events> &bits) {
+    char entry[extension_header_size + HeartBeat::max_received_events / CHAR_BIT] = {};
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < bits.size(); i++) {
+        if (bits[i]) {
+            entry[extension_header_size + i / CHAR_BIT] |= 1 << (i % CHAR_BIT);
+            length = i / CHAR_BIT + 1;  // trailing zero bytes are not sent
+        }
+    }
+
+    entry[0] = static_cast<char>(type);
+    entry[1] = static_cast<char>(length);
+    buffer.append(entry, extension_header_size + length);
+}
+
+
+static void read_bitmap(const char *data, std::size_t size,
+                        std::bitset<HeartBeat::max_received_events> &bits) noexcept {
+    for (std::size_t i = 0; i < size * CHAR_BIT; i++) {
+        bits[i] = (static_cast<uint8_t>(data[i / CHAR_BIT]) >> (i % CHAR_BIT)) & 1;
+    }
+}
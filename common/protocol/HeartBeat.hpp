@@ -1,23 +1,52 @@
 #pragma once
 
+#include <bitset>
 #include <cstdint>
 #include <string>
 
 
 // HeartBeat sent by client to server.
 // Class for convenient serializing and deserializing packets.
+//
+// Optional extensions follow player_name after a null byte (which can not
+// appear in a name) as entries: type (1 byte), length (1 byte), value.
+// Entries are sent only if they differ from defaults and unknown ones are skipped,
+// so heartbeats of legacy clients are unchanged.
 struct HeartBeat final {
+    // Bits of capabilities field.
+    enum Capability : uint32_t {
+        Snapshots = 1 << 0,            // client understands GameEvent::Type::Snapshot
+        CompressedDatagrams = 1 << 1,  // see DatagramCompression
+        PixelRuns = 1 << 2,            // client understands GameEvent::Type::PixelRun
+        // Client is a member of the server's multicast group. Live events come
+        // through it (in format for clients with the two capabilities above),
+        // only catching up and gaps are sent directly to the client.
+        MulticastEvents = 1 << 3,
+    };
+    static constexpr std::size_t max_received_events = 256;
+
     uint64_t session_id = 0;
     int8_t turn_direction = 0;
     uint32_t next_expected_event_no = 0;
     std::string player_name;
 
+    // extensions
+    uint32_t capabilities = 0;
+    uint32_t next_expected_fragment_no = 0;  // of snapshot being received
+    // Events already received beyond the expected one, bit i stands for
+    // event next_expected_event_no + 1 + i. Server skips them when resending.
+    std::bitset<max_received_events> received_events{};
+    // Number of event datagrams followed by a parity datagram, 0 if client
+    // does not want them, see DatagramParity.
+    uint32_t parity_group_size = 0;
+
     // Prepares proper binary packet. Must be called on valid struct.
     std::string serialize() const noexcept;
     // Loads binary packet updating struct fields
     // and returns true if action succeeded.
     // When error occurred, struct fields can be invalidated.
     bool deserialize(const std::string &data) noexcept;
+    bool deserialize(const char *data, std::size_t size) noexcept;
     // Check if fields contain valid values.
     bool validate() const noexcept;
 };
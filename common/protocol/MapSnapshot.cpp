@@ -0,0 +1,152 @@
+#include <common/protocol/MapSnapshot.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <endian.h>
+#include <zlib.h>
+
+
+static constexpr uint32_t max_raw_size = 64 << 20;
+
+
+void MapSnapshot::clear() noexcept {
+    maxx = maxy = 0;
+    players_names.clear();
+    eliminated.clear();
+    pixels.clear();
+}
+
+
+uint32_t MapSnapshot::events_cnt() const noexcept {
+    return 1 + pixels.size() + eliminated.size();
+}
+
+
+void MapSnapshot::compress(std::string &buffer, int level) const {
+    assert(players_names.size() <= UINT8_MAX && eliminated.size() <= UINT8_MAX);
+    auto area = static_cast<uint64_t>(maxx) * maxy;
+
+    std::string raw;
+    raw.reserve(4 * 3 + 2 + players_names.size() * 16 + eliminated.size()
+                + (area + 7) / 8 + pixels.size());
+    auto append_u32 = [&raw](uint32_t value) {
+        value = htobe32(value);
+        raw.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    append_u32(maxx);
+    append_u32(maxy);
+    raw.push_back(static_cast<char>(players_names.size()));
+    for (const auto &name : players_names) {
+        raw.append(name);
+        raw.push_back('\0');
+    }
+    raw.push_back(static_cast<char>(eliminated.size()));
+    raw.append(eliminated.begin(), eliminated.end());
+    append_u32(pixels.size());
+
+    auto bitmap_offset = raw.size();
+    raw.resize(bitmap_offset + (area + 7) / 8, '\0');
+    auto bitmap = reinterpret_cast<uint8_t*>(&raw[bitmap_offset]);
+    for (const auto &pixel : pixels) {
+        assert(pixel.x < maxx && pixel.y < maxy);
+        auto index = static_cast<uint64_t>(pixel.y) * maxx + pixel.x;
+        bitmap[index / 8] |= 1 << index % 8;
+    }
+    for (const auto &pixel : pixels) {
+        raw.push_back(static_cast<char>(pixel.player_no));
+    }
+
+    uLongf compressed_size = compressBound(raw.size());
+    buffer.resize(sizeof(uint32_t) + compressed_size);
+    *reinterpret_cast<uint32_t*>(&buffer[0]) = htobe32(raw.size());
+    compress2(reinterpret_cast<Bytef*>(&buffer[sizeof(uint32_t)]), &compressed_size,
+              reinterpret_cast<const Bytef*>(raw.data()), raw.size(), level);
+    buffer.resize(sizeof(uint32_t) + compressed_size);
+}
+
+
+bool MapSnapshot::decompress(const std::string &data) {
+    clear();
+    if (data.size() < sizeof(uint32_t)) {
+        return false;
+    }
+
+    uLongf raw_size = be32toh(*reinterpret_cast<const uint32_t*>(&data[0]));
+    if (raw_size > max_raw_size) {
+        return false;
+    }
+
+    std::string raw(raw_size, '\0');
+    auto status = uncompress(reinterpret_cast<Bytef*>(&raw[0]), &raw_size,
+                             reinterpret_cast<const Bytef*>(&data[sizeof(uint32_t)]),
+                             data.size() - sizeof(uint32_t));
+    if (status != Z_OK || raw_size != raw.size()) {
+        return false;
+    }
+
+    // reading
+    std::size_t offset = 0;
+    auto read_u32 = [&raw, &offset](uint32_t &value) {
+        if (raw.size() - offset < sizeof(value)) {
+            return false;
+        }
+        value = be32toh(*reinterpret_cast<const uint32_t*>(&raw[offset]));
+        offset += sizeof(value);
+        return true;
+    };
+    auto read_u8 = [&raw, &offset](uint8_t &value) {
+        if (offset == raw.size()) {
+            return false;
+        }
+        value = raw[offset++];
+        return true;
+    };
+
+    uint8_t players_cnt, eliminated_cnt;
+    if (!read_u32(maxx) || !read_u32(maxy) || !read_u8(players_cnt)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < players_cnt; i++) {
+        auto name_end = raw.find('\0', offset);
+        if (name_end == std::string::npos) {
+            return false;
+        }
+        players_names.emplace_back(raw, offset, name_end - offset);
+        offset = name_end + 1;
+    }
+
+    if (!read_u8(eliminated_cnt) || raw.size() - offset < eliminated_cnt) {
+        return false;
+    }
+    eliminated.assign(&raw[offset], &raw[offset] + eliminated_cnt);
+    offset += eliminated_cnt;
+
+    uint32_t pixels_cnt;
+    auto area = static_cast<uint64_t>(maxx) * maxy;
+    auto bitmap_size = (area + 7) / 8;
+    if (!read_u32(pixels_cnt) || raw.size() - offset != bitmap_size + pixels_cnt) {
+        return false;
+    }
+
+    auto bitmap = reinterpret_cast<const uint8_t*>(&raw[offset]);
+    auto owners = reinterpret_cast<const uint8_t*>(&raw[offset + bitmap_size]);
+    pixels.reserve(pixels_cnt);
+    for (uint64_t byte = 0; byte < bitmap_size; byte++) {
+        for (uint32_t bits = bitmap[byte]; bits != 0; bits &= bits - 1) {
+            auto index = byte * 8 + __builtin_ctz(bits);
+            if (index >= area || pixels.size() == pixels_cnt) {
+                return false;
+            }
+            pixels.push_back({static_cast<uint32_t>(index % maxx),
+                              static_cast<uint32_t>(index / maxx), owners[pixels.size()]});
+        }
+    }
+
+    return pixels.size() == pixels_cnt;
+}
+
+
+bool MapSnapshot::pixel_less(const Pixel &lhs, const Pixel &rhs) noexcept {
+    return lhs.y != rhs.y ? lhs.y < rhs.y : lhs.x < rhs.x;
+}
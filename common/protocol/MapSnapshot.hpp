@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// State of a game described by its events except GameOver: map size, players,
+// eliminations and occupied pixels with their owners. Sent compressed to clients
+// which join in the middle of a game, see GameEvent::Type::Snapshot.
+//
+// Compressed form is the raw size (4 bytes) followed by zlib stream of:
+// maxx, maxy (4 bytes each), players_cnt (1 byte), null terminated names,
+// eliminated_cnt (1 byte), eliminated player numbers, pixels_cnt (4 bytes),
+// occupancy bitmap of the map (row by row, lowest bit first) and owners
+// of occupied pixels in bitmap order (1 byte each).
+struct MapSnapshot final {
+    struct Pixel {
+        uint32_t x;
+        uint32_t y;
+        uint8_t player_no;
+    };
+
+    uint32_t maxx = 0;
+    uint32_t maxy = 0;
+    std::vector<std::string> players_names;
+    std::vector<uint8_t> eliminated;  // in order of elimination
+    std::vector<Pixel> pixels;        // row by row, every pixel at most once
+
+    // Removes everything, memory is kept.
+    void clear() noexcept;
+    // Number of events which snapshot stands for: NewGame, Pixels
+    // and PlayerEliminated events.
+    uint32_t events_cnt() const noexcept;
+
+    // Replaces buffer with compressed snapshot. Pixels must be sorted
+    // and lie on the map.
+    void compress(std::string &buffer, int level) const;
+    // Loads compressed snapshot and returns true on success.
+    // When error occurred, struct fields can be invalidated.
+    bool decompress(const std::string &data);
+
+    // Compares pixels in bitmap order.
+    static bool pixel_less(const Pixel &lhs, const Pixel &rhs) noexcept;
+};
@@ -1,5 +1,6 @@
 #include <common/protocol/MultipleGameEvent.hpp>
-#include <common/network/UdpSocket.hpp>
+#include <common/protocol/DatagramCompression.hpp>
+#include <common/protocol/utils.hpp>
 
 #include <cassert>
 #include <algorithm>
@@ -7,22 +8,32 @@
 
 
 std::pair<std::string, uint32_t> MultipleGameEvent::prepare_packet_from_cache(
-        const std::deque<std::string> &cache, uint32_t next_no) const noexcept {
+        const EventLog &cache, uint32_t next_no) const {
     std::string buffer;
-    buffer.reserve(max_datagram_size);
-    buffer.resize(sizeof(uint32_t));
-    *reinterpret_cast<uint32_t*>(&buffer[0]) = htobe32(game_id);
+    next_no = extend_packet_from_cache(buffer, cache, next_no);
+    return std::make_pair(buffer, next_no);
+}
+
 
-    for (; next_no < cache.size()
-           && buffer.size() + cache[next_no].size() <= max_datagram_size; next_no++) {
-        buffer += cache[next_no];
+uint32_t MultipleGameEvent::extend_packet_from_cache(std::string &packet,
+        const EventLog &cache, uint32_t next_no) const {
+    if (packet.empty()) {
+        packet.reserve(max_datagram_size);
+        packet.resize(sizeof(uint32_t));
+        *reinterpret_cast<uint32_t*>(&packet[0]) = htobe32(game_id);
     }
 
-    return std::make_pair(buffer, next_no);
+    return cache.copy_events(packet, next_no, max_datagram_size);
 }
 
 
 bool MultipleGameEvent::deserialize(const std::string &data) noexcept {
+    if (is_compressed_datagram(data.data(), data.size())) {
+        static thread_local DatagramDecompressor decompressor;
+        std::string plain;
+        return decompressor.decompress(data.data(), data.size(), plain) && deserialize(plain);
+    }
+
     events.clear();
 
     if (data.size() < sizeof(uint32_t)) {
@@ -52,6 +63,19 @@ bool MultipleGameEvent::deserialize(const std::string &data) noexcept {
             continue;
         }
 
+        if (ev_ptr->type == GameEvent::Type::PixelRun) {
+            // expanded, so receivers see only the plain events
+            const auto &pixels = ev_ptr->pixel_run_data.pixels;
+            for (std::size_t i = 0; i < pixels.size(); i++) {
+                auto pixel_ptr = std::make_unique<GameEvent>();
+                pixel_ptr->event_no = ev_ptr->event_no + i;
+                pixel_ptr->type = GameEvent::Type::Pixel;
+                pixel_ptr->pixel_data = pixels[i];
+                events.emplace_back(std::move(pixel_ptr));
+            }
+            continue;
+        }
+
         events.emplace_back(std::move(ev_ptr));
     }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 
+#include <common/protocol/EventLog.hpp>
 #include <common/protocol/GameEvent.hpp>
 
 #include <deque>
@@ -16,14 +17,19 @@ public:
     uint32_t game_id;
     Container events;
 
-    // Gets container with already serialized GameEvents and offset from which
+    // Gets log of already serialized GameEvents and offset from which
     // serialization should be started. Prepares packet with maximum possible
     // number of events and returns updated offset.
     // Must be called on valid struct.
     std::pair<std::string, uint32_t> prepare_packet_from_cache(
-            const std::deque<std::string> &cache, uint32_t next_no) const noexcept;
-    // Loads single binary packet updating class fields and returns true
-    // if at least one GameEvent was successfully deserialized.
+            const EventLog &cache, uint32_t next_no) const;
+    // Same as above, but appends events to already prepared packet (its game_id
+    // is not checked, empty packet gets one) and returns updated offset.
+    uint32_t extend_packet_from_cache(std::string &packet,
+            const EventLog &cache, uint32_t next_no) const;
+    // Loads single binary packet (plain or compressed, see DatagramCompression)
+    // updating class fields and returns true if at least one GameEvent
+    // was successfully deserialized.
     // When error occurred, struct fields can be invalidated.
     bool deserialize(const std::string &data) noexcept;
     // Check if fields contain valid values.
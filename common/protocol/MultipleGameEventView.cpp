@@ -0,0 +1,219 @@
+#include <common/protocol/MultipleGameEventView.hpp>
+#include <common/protocol/utils.hpp>
+
+#include <cstring>
+#include <endian.h>
+#include <zlib.h>
+
+
+static constexpr std::size_t event_header_size = sizeof(uint32_t) * 2 + 1;  // len, event_no, type
+static constexpr std::size_t event_overhead_size = event_header_size + sizeof(uint32_t);  // crc32
+
+static inline uint32_t read_u32(const char *data) noexcept;
+static inline uint16_t read_u16(const char *data) noexcept;
+
+
+bool MultipleGameEventView::parse(const char *data, std::size_t size) noexcept {
+    if (is_compressed_datagram(data, size)) {
+        if (!decompressor.decompress(data, size, plain)) {
+            return false;
+        }
+        data = plain.data();
+        size = plain.size();
+    }
+
+    events.clear();
+
+    if (size < sizeof(uint32_t)) {
+        return false;
+    }
+
+    game_id = read_u32(data);
+    std::size_t offset = sizeof(uint32_t);
+
+    while (offset < size) {
+        if (size - offset < sizeof(uint32_t)) {
+            return false;
+        }
+
+        const char *const event = data + offset;
+        // +sizeof(len) +sizeof(crc32)
+        std::size_t packet_size = read_u32(event) + sizeof(uint32_t) * 2;
+        if (size - offset < packet_size) {
+            return false;
+        }
+        offset += packet_size;
+
+        if (packet_size < event_overhead_size || max_datagram_size < packet_size) {
+            break;
+        }
+        const auto len = packet_size - sizeof(uint32_t) * 2;
+
+        const uint32_t crc32_value = crc32(0, reinterpret_cast<const Bytef*>(event),
+                                           sizeof(uint32_t) + len);
+        if (crc32_value != read_u32(event + sizeof(uint32_t) + len)) {
+            break;
+        }
+
+        auto type = static_cast<GameEvent::Type>(
+                *reinterpret_cast<const uint8_t*>(event + event_header_size - 1));
+        if (GameEvent::Type::PixelRun < type) {
+            continue;  // unknown event type
+        }
+
+        if (!parse_event(read_u32(event + sizeof(uint32_t)), type, event + event_header_size,
+                         packet_size - event_overhead_size)) {
+            break;
+        }
+    }
+
+    return events.size() > 0;
+}
+
+
+bool MultipleGameEventView::parse_event(uint32_t event_no, GameEvent::Type type,
+                                        const char *data, std::size_t size) noexcept {
+    if (type == GameEvent::Type::PixelRun) {
+        return parse_pixel_run(event_no, data, size);
+    }
+
+    events.emplace_back();
+    auto &event = events.back();
+    event.event_no = event_no;
+    event.type = type;
+
+    bool success = true;
+    switch (type) {
+        case GameEvent::Type::NewGame: {
+            if (size < 8 || size - 8 > GameEvent::NewGameData::names_capacity) {
+                success = false;
+                break;
+            }
+
+            auto &view = event.new_game;
+            view.maxx = read_u32(data);
+            view.maxy = read_u32(data + 4);
+            view.names = data + 8;
+            view.names_size = size - 8;
+
+            // the same rules as in NewGameData::validate
+            std::size_t names_cnt = 0;
+            auto it = view.names;
+            const auto names_end = view.names + view.names_size;
+            while (success && it < names_end) {
+                auto name_end = static_cast<const char*>(memchr(it, '\0', names_end - it));
+                success = name_end != nullptr && name_end != it
+                          && validate_player_name(it, name_end - it);
+                it = name_end + 1;
+                names_cnt++;
+            }
+            success = success && names_cnt >= 2;
+            break;
+        }
+
+        case GameEvent::Type::Pixel:
+            success = size == 9;
+            if (success) {
+                event.pixel.player_no = *reinterpret_cast<const uint8_t*>(data);
+                event.pixel.x = read_u32(data + 1);
+                event.pixel.y = read_u32(data + 5);
+            }
+            break;
+
+        case GameEvent::Type::PlayerEliminated:
+            success = size == 1;
+            if (success) {
+                event.player_eliminated.player_no = *reinterpret_cast<const uint8_t*>(data);
+            }
+            break;
+
+        case GameEvent::Type::GameOver:
+            break;
+
+        case GameEvent::Type::Snapshot: {
+            if (size < 4) {
+                success = false;
+                break;
+            }
+
+            auto &view = event.snapshot;
+            view.fragment_no = read_u16(data);
+            view.fragments_cnt = read_u16(data + 2);
+            view.fragment = data + 4;
+            view.fragment_size = size - 4;
+            success = view.fragment_no < view.fragments_cnt && view.fragment_size > 0
+                      && view.fragment_size <= GameEvent::SnapshotData::fragment_capacity;
+            break;
+        }
+
+        default:
+            success = false;
+            break;
+    }
+
+    if (!success) {
+        events.pop_back();
+    }
+    return success;
+}
+
+
+bool MultipleGameEventView::parse_pixel_run(uint32_t event_no, const char *data,
+                                            std::size_t size) noexcept {
+    using PixelRunData = GameEvent::PixelRunData;
+    auto cnt = PixelRunData::pixels_cnt(data, size);
+    if (cnt == 0) {
+        return false;
+    }
+
+    std::size_t players_cnt = *reinterpret_cast<const uint8_t*>(data);
+    GameEventView::PixelView last[PixelRunData::max_players_cnt];
+    bool started[PixelRunData::max_players_cnt] = {};
+    for (std::size_t i = 0; i < players_cnt; i++) {
+        auto start_ptr = data + 1 + i * PixelRunData::start_size;
+        last[i].player_no = *reinterpret_cast<const uint8_t*>(start_ptr);
+        last[i].x = read_u32(start_ptr + 1);
+        last[i].y = read_u32(start_ptr + 5);
+    }
+
+    const auto first_index = events.size();
+    events.resize(first_index + cnt);
+    auto entries = reinterpret_cast<const uint8_t*>(data + 1 + players_cnt * PixelRunData::start_size);
+    for (std::size_t i = 0; i < cnt; i++) {
+        std::size_t index = entries[i] >> 3;
+        auto code = entries[i] & 7;
+        if (index >= players_cnt || (!started[index] && code != 0)) {
+            events.resize(first_index);
+            return false;
+        }
+
+        auto &pixel = last[index];
+        if (started[index]) {
+            pixel.x += PixelRunData::steps[code][0];
+            pixel.y += PixelRunData::steps[code][1];
+        }
+        started[index] = true;
+
+        auto &event = events[first_index + i];
+        event.event_no = event_no + i;
+        event.type = GameEvent::Type::Pixel;
+        event.pixel = pixel;
+    }
+
+    return true;
+}
+
+
+// --------------------------------------- helpers
+static inline uint32_t read_u32(const char *data) noexcept {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return be32toh(value);
+}
+
+
+static inline uint16_t read_u16(const char *data) noexcept {
+    uint16_t value;
+    memcpy(&value, data, sizeof(value));
+    return be16toh(value);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <common/protocol/DatagramCompression.hpp>
+#include <common/protocol/GameEvent.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Binary GameEvent decoded in place: fixed-size fields are copied out,
+// variable-size ones point into the buffer the event was parsed from.
+struct GameEventView final {
+    struct NewGameView {
+        uint32_t maxx, maxy;
+        const char *names;   // null terminated, one after another
+        uint32_t names_size;
+    };
+
+    struct PixelView {
+        uint8_t player_no;
+        uint32_t x, y;
+    };
+
+    struct PlayerEliminatedView {
+        uint8_t player_no;
+    };
+
+    struct SnapshotView {
+        uint16_t fragment_no, fragments_cnt;
+        const char *fragment;
+        uint32_t fragment_size;
+    };
+
+    uint32_t event_no = 0;
+    GameEvent::Type type = GameEvent::Type::NewGame;
+    union {
+        NewGameView new_game;
+        PixelView pixel;
+        PlayerEliminatedView player_eliminated;
+        SnapshotView snapshot;
+    };
+
+    GameEventView() noexcept : new_game{0, 0, nullptr, 0} {}
+};
+
+
+// Zero-copy counterpart of MultipleGameEvent::deserialize, accepting the same
+// datagrams: events are checked (len, crc32, the same validation) over spans
+// of the received buffer, PixelRun events are expanded to Pixel ones.
+// One parser is meant to be reused, so in steady state it does not allocate.
+class MultipleGameEventView final {
+public:
+    uint32_t game_id = 0;
+    std::vector<GameEventView> events;  // valid until the next parse and
+                                        // as long as the parsed buffer
+
+private:
+    DatagramDecompressor decompressor;
+    std::string plain;  // compressed datagrams are decompressed here
+
+public:
+    // Returns true if at least one event was successfully parsed.
+    // Events with unknown types are skipped, the first malformed one ends parsing.
+    bool parse(const char *data, std::size_t size) noexcept;
+
+private:
+    // Returns false if event is malformed.
+    bool parse_event(uint32_t event_no, GameEvent::Type type,
+                     const char *data, std::size_t size) noexcept;
+    bool parse_pixel_run(uint32_t event_no, const char *data, std::size_t size) noexcept;
+};
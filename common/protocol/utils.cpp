@@ -1,17 +1,23 @@
 #include <common/protocol/utils.hpp>
 
 
+constexpr std::size_t max_datagram_size = 512;
 constexpr std::size_t max_player_name_length = 64;
 static inline constexpr bool is_allowed_player_name_character(char c) noexcept;
 
 
 bool validate_player_name(const std::string &player_name) noexcept {
-    if (player_name.length() > max_player_name_length) {
+    return validate_player_name(player_name.data(), player_name.length());
+}
+
+
+bool validate_player_name(const char *player_name, std::size_t length) noexcept {
+    if (length > max_player_name_length) {
         return false;
     }
 
-    for (auto c : player_name) {
-        if (!is_allowed_player_name_character(c)) {
+    for (std::size_t i = 0; i < length; i++) {
+        if (!is_allowed_player_name_character(player_name[i])) {
             return false;
         }
     }
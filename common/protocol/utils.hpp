@@ -3,7 +3,9 @@
 #include <string>
 
 
+extern const std::size_t max_datagram_size;
 extern const std::size_t max_player_name_length;
 
 
 bool validate_player_name(const std::string &player_name) noexcept;
+bool validate_player_name(const char *player_name, std::size_t length) noexcept;
@@ -0,0 +1,49 @@
+#include <server/CollisionMap.hpp>
+
+#include <algorithm>
+
+
+CollisionMap::CollisionMap(uint32_t width, uint32_t height)
+        : tiles_in_row((width + tile_mask) >> tile_bits) {
+    std::size_t tiles_cnt = static_cast<std::size_t>(tiles_in_row)
+                            * ((height + tile_mask) >> tile_bits);
+    tile_generations.resize(tiles_cnt, 0);
+    words.resize(tiles_cnt * tile_side, 0);
+}
+
+
+void CollisionMap::clear() noexcept {
+    generation++;
+    if (generation == 0) {
+        // generations wrapped, old ones could be taken for current
+        std::fill(tile_generations.begin(), tile_generations.end(), 0);
+        generation = 1;
+    }
+}
+
+
+bool CollisionMap::get(uint32_t x, uint32_t y) const noexcept {
+    auto tile = tile_of(x, y);
+    if (tile_generations[tile] != generation) {
+        return false;
+    }
+
+    return words[tile * tile_side + (y & tile_mask)] >> (x & tile_mask) & 1;
+}
+
+
+void CollisionMap::set(uint32_t x, uint32_t y) noexcept {
+    auto tile = tile_of(x, y);
+    auto tile_words = &words[tile * tile_side];
+    if (tile_generations[tile] != generation) {
+        std::fill(tile_words, tile_words + tile_side, 0);
+        tile_generations[tile] = generation;
+    }
+
+    tile_words[y & tile_mask] |= uint64_t(1) << (x & tile_mask);
+}
+
+
+std::size_t CollisionMap::tile_of(uint32_t x, uint32_t y) const noexcept {
+    return static_cast<std::size_t>(y >> tile_bits) * tiles_in_row + (x >> tile_bits);
+}
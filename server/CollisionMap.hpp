@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+// Bitmap of occupied pixels, split into square tiles of 64x64 bits.
+// Every tile row is a single 64-bit word and the whole tile lies in 512 bytes,
+// so trails going in any direction stay in a few cache lines.
+//
+// Tiles are cleared lazily: each one remembers the generation (game) in which
+// it was last written and is treated as empty in any other generation.
+// Therefore clear() is O(1) and a new game zeroes only tiles it touches.
+class CollisionMap final {
+private:
+    static constexpr uint32_t tile_bits = 6;
+    static constexpr uint32_t tile_side = 1 << tile_bits;  // 64
+    static constexpr uint32_t tile_mask = tile_side - 1;
+
+    uint32_t tiles_in_row;
+    uint32_t generation = 1;
+    std::vector<uint32_t> tile_generations;  // 0 - never written
+    std::vector<uint64_t> words;             // tile by tile, row by row
+
+public:
+    CollisionMap(uint32_t width, uint32_t height);
+
+    // Marks all pixels as free.
+    void clear() noexcept;
+    // Coordinates must be on the map.
+    bool get(uint32_t x, uint32_t y) const noexcept;
+    void set(uint32_t x, uint32_t y) noexcept;
+
+private:
+    std::size_t tile_of(uint32_t x, uint32_t y) const noexcept;
+};
@@ -0,0 +1,71 @@
+#include <server/DatagramCache.hpp>
+#include <common/protocol/MultipleGameEvent.hpp>
+#include <common/protocol/utils.hpp>
+
+#include <cassert>
+#include <endian.h>
+
+
+DatagramCache::DatagramCache(bool compressed, bool pixel_runs)
+        : pixel_runs(pixel_runs) {
+    if (compressed) {
+        compressor = std::make_unique<DatagramCompressor>();
+    }
+}
+
+
+void DatagramCache::reset(uint32_t game_id) {
+    this->game_id = game_id;
+    datagrams.clear();
+}
+
+
+const DatagramCache::Datagram &DatagramCache::get(
+        const EventLog &events, uint32_t first_event_no) {
+    assert(first_event_no < events.size());
+
+    auto it = datagrams.find(first_event_no);
+    if (it == datagrams.end()) {
+        it = datagrams.emplace(first_event_no, Datagram{std::string(), first_event_no, false}).first;
+    }
+
+    auto &datagram = it->second;
+    if (!datagram.full && datagram.end_event_no < events.size()) {
+        if (compressor || pixel_runs) {
+            rebuild(datagram, events, first_event_no);
+        }
+        else {
+            MultipleGameEvent mge;
+            mge.game_id = game_id;
+            datagram.end_event_no = mge.extend_packet_from_cache(
+                    datagram.data, events, datagram.end_event_no);
+        }
+        datagram.full = datagram.end_event_no < events.size();
+    }
+
+    return datagram;
+}
+
+
+void DatagramCache::rebuild(Datagram &datagram, const EventLog &events, uint32_t first_event_no) {
+    if (!compressor) {
+        // plain datagram with pixel runs
+        uint32_t game_id_be = htobe32(game_id);
+        datagram.data.assign(reinterpret_cast<const char*>(&game_id_be), sizeof(game_id_be));
+        datagram.end_event_no = events.copy_events_with_pixel_runs(
+                datagram.data, first_event_no, max_datagram_size);
+        return;
+    }
+
+    // Compressed runs pay off only for clients far behind: up to date client
+    // gets about one pixel per player, which compresses better as Pixel event.
+    input.clear();
+    auto end_no = events.copy_events(input, first_event_no, DatagramCompressor::max_input_size);
+    if (pixel_runs && end_no < events.size()) {
+        input.clear();
+        events.copy_events_with_pixel_runs(input, first_event_no,
+                                           DatagramCompressor::max_input_size);
+    }
+    datagram.end_event_no = first_event_no
+                            + compressor->prepare_packet(datagram.data, game_id, input);
+}
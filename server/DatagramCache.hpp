@@ -0,0 +1,51 @@
+#pragma once
+
+#include <common/protocol/DatagramCompression.hpp>
+#include <common/protocol/EventLog.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+// Finished datagrams of the current game, keyed by their first event number.
+// Up to date clients ask for the same events, so they share one buffer instead
+// of building the same datagram over and over again.
+//
+// Datagram which has no space left is never changed again. Datagram which ends
+// with the last event is extended (in place, it has capacity for the maximum
+// datagram size) only when new events are appended to the game. Compressed
+// datagrams and ones with pixel runs are built again instead.
+class DatagramCache final {
+public:
+    struct Datagram {
+        std::string data;
+        uint32_t end_event_no;  // number of the first event not included
+        bool full;              // the next event does not fit
+    };
+
+private:
+    uint32_t game_id = 0;
+    // Keyed by the first event number, only datagrams which were asked for
+    // are stored. Nodes stay in place while the map grows.
+    std::unordered_map<uint32_t, Datagram> datagrams;
+    std::unique_ptr<DatagramCompressor> compressor;  // only for compressed datagrams
+    bool pixel_runs;
+    std::string input;  // serialized events for rebuilt datagrams
+
+public:
+    // Cache of plain or compressed datagrams (see DatagramCompression),
+    // optionally with consecutive pixels put into PixelRun events.
+    explicit DatagramCache(bool compressed = false, bool pixel_runs = false);
+
+    // Drops all datagrams, following ones will be built for given game.
+    void reset(uint32_t game_id);
+
+    // Returns datagram of the current game starting with event first_event_no
+    // (which must be < events.size()). Events are the log of the game,
+    // reference is valid until the next reset().
+    const Datagram &get(const EventLog &events, uint32_t first_event_no);
+
+private:
+    void rebuild(Datagram &datagram, const EventLog &events, uint32_t first_event_no);
+};
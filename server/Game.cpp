@@ -0,0 +1,289 @@
+#include <server/Game.hpp>
+#include <server/Log.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+
+static constexpr auto deg_to_rad = M_PI / 180.;
+
+// Movement::FixedPoint
+static constexpr auto fixed_point_shift = 32;
+static constexpr auto fixed_point_half = int64_t(1) << (fixed_point_shift - 1);
+
+struct Direction {
+    int64_t dx;
+    int64_t dy;
+};
+
+// 360 unit vectors for whole degrees, in fixed point
+static const std::array<Direction, 360> &direction_table() noexcept;
+
+
+Game::Game(const Config &config, std::string log_prefix)
+        : config(config), log_prefix(std::move(log_prefix)) {
+    game_state.map = CollisionMap(config.map_width, config.map_height);
+}
+
+
+void Game::start(uint32_t game_id, std::vector<std::string> names,
+                 RandomNumberGenerator &rand_gen) {
+    std::sort(names.begin(), names.end());
+
+    // Crop the player list if they do not fit into one UDP datagram
+    GameEvent ev;
+    ev.type = GameEvent::Type::NewGame;
+    ev.new_game_data.maxx = config.map_width;
+    ev.new_game_data.maxy = config.map_height;
+    ev.new_game_data.players_names = std::move(names);
+
+    auto &pl_names = ev.new_game_data.players_names;
+    auto names_size = ev.new_game_data.calculate_used_names_capacity();
+    while (ev.new_game_data.names_capacity < names_size) {
+        names_size -= pl_names.size() + 1;
+        pl_names.pop_back();
+    }
+
+    // Emit NewGame event
+    game_state.game_id = game_id;
+    game_state.events.clear();
+    game_state.game_in_progress = true;
+    if (!ev.validate(GameEvent::Format::Binary)) {
+        LogLine(log_prefix) << "Warning: Tried to emit invalid game event. "
+                            << "Dropping it.";
+    }
+    else {
+        game_state.events.append_new_game(ev.new_game_data.maxx, ev.new_game_data.maxy,
+                                          pl_names);
+    }
+    game_state.players.resize(pl_names.size());
+    game_state.alive_players_cnt = game_state.players.size();
+
+    // Init map
+    game_state.map.clear();
+
+    // Init players
+    for (std::size_t ind = 0; ind < game_state.players.size(); ind++) {
+        auto &player = game_state.players[ind];
+
+        player.name = pl_names[ind];
+        player.turn_direction = 0;
+        player.alive = true;
+        uint32_t x = rand_gen.next() % config.map_width;
+        uint32_t y = rand_gen.next() % config.map_height;
+        player.pos_x = x + 0.5;
+        player.pos_y = y + 0.5;
+        player.fixed_x = (int64_t(x) << fixed_point_shift) + fixed_point_half;
+        player.fixed_y = (int64_t(y) << fixed_point_shift) + fixed_point_half;
+        player.angle = rand_gen.next() % 360;
+
+        if (map_get(x, y)) {
+            if (handle_player_eliminated_event(ind)) {
+                return; // game over
+            }
+        }
+        else {
+            handle_pixel_event(ind, x, y);
+        }
+    }
+}
+
+
+void Game::update() {
+    assert(game_state.game_in_progress);
+
+    for (std::size_t ind = 0; ind < game_state.players.size(); ind++) {
+        auto &player = game_state.players[ind];
+        if (!player.alive) {
+            continue;
+        }
+
+        uint32_t last_x, last_y;
+        if (config.movement == Movement::FixedPoint) {
+            last_x = player.fixed_x >> fixed_point_shift;
+            last_y = player.fixed_y >> fixed_point_shift;
+        }
+        else {
+            last_x = player.pos_x;
+            last_y = player.pos_y;
+        }
+
+        if (player.turn_direction == -1) {
+            player.angle -= config.turning_speed;
+            if (player.angle < 0) {
+                player.angle += 360;
+            }
+        }
+        else if (player.turn_direction == 1) {
+            player.angle += config.turning_speed;
+            if (player.angle >= 360) {
+                player.angle -= 360;
+            }
+        }
+
+        uint32_t new_x, new_y;
+        bool on_map = move_player(player, new_x, new_y);
+
+        if (last_x == new_x && last_y == new_y) {
+            continue;
+        }
+
+        if (!on_map || map_get(new_x, new_y)) {
+            if (handle_player_eliminated_event(ind)) {
+                return;  // game over
+            }
+        }
+        else {
+            handle_pixel_event(ind, new_x, new_y);
+        }
+    }
+}
+
+
+void Game::set_turn_direction(uint8_t player_no, int8_t turn_direction) noexcept {
+    assert(player_no < game_state.players.size());
+    game_state.players[player_no].turn_direction = turn_direction;
+}
+
+
+bool Game::is_in_progress() const noexcept {
+    return game_state.game_in_progress;
+}
+
+
+uint32_t Game::get_game_id() const noexcept {
+    return game_state.game_id;
+}
+
+
+const std::vector<Game::Player> &Game::get_players() const noexcept {
+    return game_state.players;
+}
+
+
+const EventLog &Game::get_events() const noexcept {
+    return game_state.events;
+}
+
+
+bool Game::is_on_map(double x, double y) const {
+    return 0 <= x && x < config.map_width &&
+           0 <= y && y < config.map_height;
+}
+
+
+bool Game::is_on_map_fixed(int64_t x, int64_t y) const {
+    return 0 <= x && (x >> fixed_point_shift) < config.map_width &&
+           0 <= y && (y >> fixed_point_shift) < config.map_height;
+}
+
+
+bool Game::move_player(Player &player, uint32_t &x, uint32_t &y) const {
+    if (config.movement == Movement::FixedPoint) {
+        const auto &direction = direction_table()[static_cast<uint32_t>(player.angle)];
+        player.fixed_x += direction.dx;
+        player.fixed_y += direction.dy;
+
+        x = player.fixed_x >> fixed_point_shift;
+        y = player.fixed_y >> fixed_point_shift;
+        return is_on_map_fixed(player.fixed_x, player.fixed_y);
+    }
+
+    player.pos_x += cos(player.angle * deg_to_rad);
+    player.pos_y += sin(player.angle * deg_to_rad);
+
+    x = player.pos_x;
+    y = player.pos_y;
+    return is_on_map(player.pos_x, player.pos_y);
+}
+
+
+void Game::map_set(uint32_t x, uint32_t y) {
+    game_state.map.set(x, y);
+}
+
+
+bool Game::map_get(uint32_t x, uint32_t y) const {
+    return game_state.map.get(x, y);
+}
+
+
+void Game::handle_pixel_event(uint8_t player_no, uint32_t x, uint32_t y) {
+    game_state.events.append_pixel(player_no, x, y);
+    map_set(x, y);
+}
+
+
+bool Game::handle_player_eliminated_event(uint8_t player_no) {
+    game_state.events.append_player_eliminated(player_no);
+    if (config.log_events) {
+        LogLine(log_prefix) << log_name(game_state.players[player_no].name, true)
+                            << " is eliminated.";
+    }
+
+    game_state.players[player_no].alive = false;
+    game_state.alive_players_cnt--;
+    if (game_state.alive_players_cnt <= 1) {
+        game_state.game_in_progress = false;
+        game_state.events.append_game_over();
+        if (config.log_events) {
+            LogLine(log_prefix) << "Game over.";
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+
+// --------------------------------------- helpers
+static const std::array<Direction, 360> &direction_table() noexcept {
+    // round(cos(d) * 2^32) for d = 0, 1, ..., 90 degrees. Hardcoded, so the table
+    // does not depend on libm and trails are the same on every platform.
+    static constexpr int64_t quarter_cos[91] = {
+        4294967296, 4294313152, 4292350918, 4289081193, 4284504972,
+        4278623649, 4271439016, 4262953261, 4253168970, 4242089121,
+        4229717092, 4216056650, 4201111956, 4184887562, 4167388412,
+        4148619834, 4128587547, 4107297652, 4084756634, 4060971360,
+        4035949075, 4009697400, 3982224333, 3953538241, 3923647864,
+        3892562305, 3860291035, 3826843882, 3792231035, 3756463039,
+        3719550787, 3681505524, 3642338838, 3602062661, 3560689261,
+        3518231241, 3474701533, 3430113397, 3384480416, 3337816489,
+        3290135830, 3241452965, 3191782722, 3141140230, 3089540917,
+        3037000500, 2983534983, 2929160652, 2873894071, 2817752074,
+        2760751762, 2702910498, 2644245902, 2584775843, 2524518436,
+        2463492036, 2401715233, 2339206844, 2275985909, 2212071688,
+        2147483648, 2082241464, 2016365009, 1949874349, 1882789739,
+        1815131613, 1746920580, 1678177418, 1608923068, 1539178623,
+        1468965330, 1398304576, 1327217885, 1255726910, 1183853429,
+        1111619334, 1039046630, 966157422, 892973913, 819518395,
+        745813244, 671880911, 597743917, 523424844, 448946331,
+        374331065, 299601773, 224781220, 149892197, 74957515,
+        0
+    };
+
+    static const auto table = []() {
+        std::array<Direction, 360> result;
+        auto fixed_cos = [](uint32_t degrees) {
+            auto quadrant = degrees / 90;
+            auto rest = degrees % 90;
+            switch (quadrant) {
+                case 0:  return quarter_cos[rest];
+                case 1:  return -quarter_cos[90 - rest];
+                case 2:  return -quarter_cos[rest];
+                default: return quarter_cos[90 - rest];
+            }
+        };
+
+        for (uint32_t degrees = 0; degrees < 360; degrees++) {
+            result[degrees].dx = fixed_cos(degrees);
+            result[degrees].dy = fixed_cos((degrees + 270) % 360);  // sin
+        }
+        return result;
+    }();
+
+    return table;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <server/CollisionMap.hpp>
+#include <common/RandomNumberGenerator.hpp>
+#include <common/protocol/EventLog.hpp>
+#include <common/protocol/GameEvent.hpp>
+
+#include <string>
+#include <vector>
+
+
+// Game engine: players, map and events of a single game.
+// It knows nothing about clients, sockets and time.
+class Game final {
+public:
+    // represents player in game
+    struct Player {
+        std::string name;
+        int8_t turn_direction;
+        bool alive;
+        double pos_x;
+        double pos_y;
+        double angle;     // always whole degrees
+        int64_t fixed_x;  // position in Movement::FixedPoint,
+        int64_t fixed_y;  // with 32 fractional bits
+    };
+
+    enum class Movement {
+        Double,      // cos/sin from libm on doubles
+        FixedPoint,  // precomputed directions, same trails on every platform
+    };
+
+    struct Config {
+        uint32_t map_width = 800;
+        uint32_t map_height = 600;
+        uint32_t turning_speed = 6;
+        Movement movement = Movement::Double;
+        bool log_events = true;  // eliminations and game overs, warnings are always logged
+    };
+
+private:
+    Config config;
+    std::string log_prefix;
+
+    // game state
+    struct {
+        std::vector<Player> players;
+        uint8_t alive_players_cnt = 0;
+        uint32_t game_id = 0;
+        bool game_in_progress = false;
+        CollisionMap map{0, 0};  // sized in constructor
+        EventLog events;
+    } game_state;
+
+public:
+    // log_prefix is put at the beginning of every logged line
+    Game(const Config &config, std::string log_prefix);
+
+    // Starts new game with players of given names. Names are sorted and cropped
+    // if they do not fit into NewGame event, player_no is the index of player's name
+    // in get_players(). Initial positions are taken from rand_gen.
+    void start(uint32_t game_id, std::vector<std::string> names,
+               RandomNumberGenerator &rand_gen);
+    // Performs single round of game in progress.
+    void update();
+    void set_turn_direction(uint8_t player_no, int8_t turn_direction) noexcept;
+
+    bool is_in_progress() const noexcept;
+    uint32_t get_game_id() const noexcept;
+    const std::vector<Player> &get_players() const noexcept;
+    const EventLog &get_events() const noexcept;
+
+private:
+    bool is_on_map(double x, double y) const;
+    bool is_on_map_fixed(int64_t x, int64_t y) const;
+    // Moves player by one pixel in its direction and returns its new pixel.
+    // Returns false if player left the map.
+    bool move_player(Player &player, uint32_t &x, uint32_t &y) const;
+    void map_set(uint32_t x, uint32_t y);
+    bool map_get(uint32_t x, uint32_t y) const;
+    void handle_pixel_event(uint8_t player_no, uint32_t x, uint32_t y);
+    // Returns true if game is over.
+    bool handle_player_eliminated_event(uint8_t player_no);
+};
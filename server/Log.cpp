@@ -0,0 +1,28 @@
+#include <server/Log.hpp>
+
+#include <iostream>
+#include <mutex>
+
+
+static std::mutex log_mutex;
+
+
+LogLine::LogLine(const std::string &prefix) {
+    str << prefix;
+}
+
+
+LogLine::~LogLine() noexcept {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    std::cout << str.str() << std::endl;
+}
+
+
+std::string log_name(const std::string &name, bool capitalized) {
+    std::string result = name.empty() ? "observer" : "player \"" + name + "\"";
+    if (capitalized) {
+        result[0] += 'A' - 'a';
+    }
+
+    return result;
+}
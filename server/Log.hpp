@@ -0,0 +1,30 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+
+// Collects a single line of log and prints it to std::cout at once when destroyed,
+// so lines logged by rooms running on different threads do not interleave.
+// Usage: LogLine(prefix) << "Player " << name << " connected.";
+class LogLine final {
+private:
+    std::ostringstream str;
+
+public:
+    explicit LogLine(const std::string &prefix);
+    LogLine(const LogLine &line) = delete;
+    LogLine &operator=(const LogLine &line) = delete;
+    ~LogLine() noexcept;
+
+    template<typename T>
+    LogLine &operator<<(T &&value) {
+        str << std::forward<T>(value);
+        return *this;
+    }
+};
+
+
+// Returns "player "name"" or "observer" (for empty name) for logging.
+std::string log_name(const std::string &name, bool capitalized);
@@ -0,0 +1,363 @@
+#include <server/Recording.hpp>
+#include <common/protocol/GameEvent.hpp>
+#include <common/protocol/utils.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <endian.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+const uint32_t Recording::keyframe_interval = 256;
+
+static constexpr char file_magic[8] = {'S', 'I', 'K', 'T', 'R', 'E', 'C', '1'};
+static constexpr uint32_t block_magic = 0x4B4C4247;  // "GBLK"
+static constexpr std::size_t min_mapping_size = 16 << 20;
+static const std::size_t max_event_size = max_datagram_size - sizeof(uint32_t);  // game_id
+
+struct FileHeader {
+    char magic[8];
+    uint64_t used_size;
+};
+
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t game_id;
+    uint32_t rounds_per_second;
+    uint32_t events_cnt;
+    uint32_t ticks_cnt;
+    uint32_t keyframes_cnt;
+    uint64_t events_size;
+    uint64_t block_size;
+};
+
+static std::size_t align8(std::size_t size) noexcept;
+static std::size_t event_size_at(const char *event) noexcept;
+static bool is_valid_event(const char *event, std::size_t size, uint32_t event_no) noexcept;
+
+
+Recording::~Recording() noexcept {
+    close_file();
+}
+
+
+bool Recording::open_for_writing(const std::string &path) {
+    close_file();
+    writable = true;
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat file_stat;
+    if (fd < 0 || fstat(fd, &file_stat) != 0) {
+        close_file();
+        return false;
+    }
+
+    if (file_stat.st_size == 0) {
+        if (!reserve(sizeof(FileHeader))) {
+            close_file();
+            return false;
+        }
+        auto header = reinterpret_cast<FileHeader*>(mapping);
+        memcpy(header->magic, file_magic, sizeof(file_magic));
+        header->used_size = used_size = sizeof(FileHeader);
+        return true;
+    }
+
+    // existing recording, new games go after the used part
+    if (static_cast<std::size_t>(file_stat.st_size) < sizeof(FileHeader)
+            || !reserve(file_stat.st_size)) {
+        close_file();
+        return false;
+    }
+    auto header = reinterpret_cast<FileHeader*>(mapping);
+    if (memcmp(header->magic, file_magic, sizeof(file_magic)) != 0
+            || header->used_size > mapping_size) {
+        close_file();
+        return false;
+    }
+    used_size = header->used_size;
+
+    return true;
+}
+
+
+bool Recording::open_for_reading(const std::string &path) {
+    close_file();
+    writable = false;
+
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat file_stat;
+    if (fd < 0 || fstat(fd, &file_stat) != 0
+            || static_cast<std::size_t>(file_stat.st_size) < sizeof(FileHeader)) {
+        close_file();
+        return false;
+    }
+
+    mapping_size = file_stat.st_size;
+    void *ptr = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        mapping_size = 0;
+        close_file();
+        return false;
+    }
+    mapping = static_cast<char*>(ptr);
+
+    auto header = reinterpret_cast<const FileHeader*>(mapping);
+    if (memcmp(header->magic, file_magic, sizeof(file_magic)) != 0
+            || header->used_size > mapping_size) {
+        close_file();
+        return false;
+    }
+    used_size = header->used_size;
+
+    if (!index_games()) {
+        close_file();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool Recording::append_game(uint32_t game_id, uint32_t rounds_per_second,
+                            const EventLog &events, const std::vector<uint32_t> &tick_ends) {
+    assert(writable);
+    std::lock_guard<std::mutex> lock(write_mutex);
+
+    BlockHeader block = {};
+    block.magic = block_magic;
+    block.game_id = game_id;
+    block.rounds_per_second = rounds_per_second;
+    block.events_cnt = events.size();
+    block.ticks_cnt = tick_ends.size();
+    block.keyframes_cnt = (block.events_cnt + keyframe_interval - 1) / keyframe_interval;
+    for (uint32_t event_no = 0; event_no < events.size(); event_no++) {
+        block.events_size += events.event_size(event_no);
+    }
+
+    auto keyframes_offset = sizeof(BlockHeader);
+    auto tick_ends_offset = keyframes_offset + block.keyframes_cnt * sizeof(uint64_t);
+    auto events_offset = tick_ends_offset + block.ticks_cnt * sizeof(uint32_t);
+    block.block_size = align8(events_offset + block.events_size);
+
+    if (!reserve(used_size + block.block_size)) {
+        return false;
+    }
+
+    auto block_ptr = mapping + used_size;
+    memcpy(block_ptr, &block, sizeof(block));
+    memcpy(block_ptr + tick_ends_offset, tick_ends.data(), tick_ends.size() * sizeof(uint32_t));
+
+    auto keyframes = reinterpret_cast<uint64_t*>(block_ptr + keyframes_offset);
+    uint64_t offset = 0;
+    for (uint32_t event_no = 0; event_no < events.size(); event_no++) {
+        if (event_no % keyframe_interval == 0) {
+            keyframes[event_no / keyframe_interval] = offset;
+        }
+
+        auto size = events.event_size(event_no);
+        memcpy(block_ptr + events_offset + offset, events.event_data(event_no), size);
+        offset += size;
+    }
+
+    // the block is visible to readers only after it is complete
+    used_size += block.block_size;
+    reinterpret_cast<FileHeader*>(mapping)->used_size = used_size;
+
+    return true;
+}
+
+
+std::size_t Recording::games_cnt() const noexcept {
+    return games.size();
+}
+
+
+const Recording::RecordedGame &Recording::get_game(std::size_t index) const noexcept {
+    assert(index < games.size());
+    return games[index];
+}
+
+
+std::size_t Recording::find_game(uint32_t game_id) const noexcept {
+    auto it = games_by_id.find(game_id);
+    return it != games_by_id.end() ? it->second : games.size();
+}
+
+
+const char *Recording::find_event(const RecordedGame &game, uint32_t event_no) noexcept {
+    assert(event_no < game.events_cnt);
+
+    auto keyframe_no = event_no / keyframe_interval;
+    auto event = game.events + game.keyframes[keyframe_no];
+    for (auto no = keyframe_no * keyframe_interval; no < event_no; no++) {
+        event += event_size_at(event);
+    }
+
+    return event;
+}
+
+
+uint32_t Recording::events_range(const RecordedGame &game, uint32_t first_no,
+                                 uint32_t end_no, std::size_t max_size,
+                                 const char *&data, std::size_t &size) noexcept {
+    assert(first_no < end_no && end_no <= game.events_cnt);
+
+    data = find_event(game, first_no);
+    size = 0;
+    auto no = first_no;
+    for (; no < end_no; no++) {
+        auto ev_size = event_size_at(data + size);
+        if (size + ev_size > max_size) {
+            break;
+        }
+        size += ev_size;
+    }
+
+    return no;
+}
+
+
+void Recording::close_file() noexcept {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    fd = -1;
+    mapping = nullptr;
+    mapping_size = used_size = 0;
+    games.clear();
+    games_by_id.clear();
+}
+
+
+bool Recording::reserve(std::size_t size) noexcept {
+    if (size <= mapping_size) {
+        return true;
+    }
+
+    auto new_size = std::max(std::max(size, 2 * mapping_size), min_mapping_size);
+    if (ftruncate(fd, new_size) != 0) {
+        return false;
+    }
+
+    void *ptr = mapping == nullptr
+                ? mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                : mremap(mapping, mapping_size, new_size, MREMAP_MAYMOVE);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+
+    mapping = static_cast<char*>(ptr);
+    mapping_size = new_size;
+    return true;
+}
+
+
+bool Recording::index_games() noexcept {
+    std::size_t offset = sizeof(FileHeader);
+
+    while (offset < used_size) {
+        if (offset + sizeof(BlockHeader) > used_size) {
+            return false;
+        }
+
+        auto block_ptr = mapping + offset;
+        auto block = reinterpret_cast<const BlockHeader*>(block_ptr);
+        auto keyframes_offset = sizeof(BlockHeader);
+        auto tick_ends_offset = keyframes_offset + uint64_t(block->keyframes_cnt) * sizeof(uint64_t);
+        auto events_offset = tick_ends_offset + uint64_t(block->ticks_cnt) * sizeof(uint32_t);
+        if (block->magic != block_magic || block->rounds_per_second == 0
+                || block->events_cnt == 0 || block->ticks_cnt == 0
+                || block->keyframes_cnt != (block->events_cnt + keyframe_interval - 1)
+                                           / keyframe_interval
+                || block->block_size < events_offset + block->events_size
+                || block->block_size > used_size - offset) {
+            return false;
+        }
+
+        RecordedGame game;
+        game.game_id = block->game_id;
+        game.rounds_per_second = block->rounds_per_second;
+        game.events_cnt = block->events_cnt;
+        game.ticks_cnt = block->ticks_cnt;
+        game.keyframes = reinterpret_cast<const uint64_t*>(block_ptr + keyframes_offset);
+        game.tick_ends = reinterpret_cast<const uint32_t*>(block_ptr + tick_ends_offset);
+        game.events = block_ptr + events_offset;
+
+        // Deserialize all events once, so they can be trusted later: rooms send
+        // them as they are (each must fit into a datagram after game_id) and
+        // snapshot cache parses them without any checks.
+        uint64_t event_offset = 0;
+        for (uint32_t event_no = 0; event_no < game.events_cnt; event_no++) {
+            if (event_no % keyframe_interval == 0
+                    && game.keyframes[event_no / keyframe_interval] != event_offset) {
+                return false;
+            }
+            if (event_offset + sizeof(uint32_t) > block->events_size) {
+                return false;
+            }
+            auto event_size = event_size_at(game.events + event_offset);
+            if (event_size > max_event_size || event_offset + event_size > block->events_size
+                    || !is_valid_event(game.events + event_offset, event_size, event_no)) {
+                return false;
+            }
+            event_offset += event_size;
+        }
+        if (event_offset != block->events_size
+                || game.tick_ends[game.ticks_cnt - 1] != game.events_cnt) {
+            return false;
+        }
+        for (uint32_t tick = 1; tick < game.ticks_cnt; tick++) {
+            if (game.tick_ends[tick - 1] > game.tick_ends[tick]) {
+                return false;
+            }
+        }
+
+        games_by_id[game.game_id] = games.size();
+        games.push_back(game);
+        offset += block->block_size;
+    }
+
+    return true;
+}
+
+
+// --------------------------------------- helpers
+static std::size_t align8(std::size_t size) noexcept {
+    return (size + 7) & ~std::size_t(7);
+}
+
+
+static std::size_t event_size_at(const char *event) noexcept {
+    return be32toh(*reinterpret_cast<const uint32_t*>(event)) + sizeof(uint32_t) * 2;
+}
+
+
+static bool is_valid_event(const char *event, std::size_t size, uint32_t event_no) noexcept {
+    GameEvent game_event;
+    if (game_event.deserialize(GameEvent::Format::Binary, std::string(event, size))
+                != GameEvent::DeserializationResult::Success
+            || game_event.event_no != event_no) {
+        return false;
+    }
+
+    // only events of a game, NewGame starts it
+    switch (game_event.type) {
+        case GameEvent::Type::NewGame:
+            return event_no == 0;
+        case GameEvent::Type::Pixel:
+        case GameEvent::Type::PlayerEliminated:
+        case GameEvent::Type::GameOver:
+            return event_no != 0;
+        default:
+            return false;
+    }
+}
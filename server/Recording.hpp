@@ -0,0 +1,86 @@
+#pragma once
+
+#include <common/protocol/EventLog.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Memory-mapped file with events of finished games, written by rooms at game over
+// and served back in replay mode.
+//
+// Layout (numbers in host byte order, blocks aligned to 8 bytes):
+//   file header:  magic, size of used part of the file
+//   game blocks, one after another:
+//     header:     magic, game_id, rounds_per_second, number of events, ticks
+//                 and keyframes, size of events, size of the whole block
+//     keyframes:  offset (in events) of every keyframe_interval-th event
+//     tick ends:  number of events emitted up to the end of each tick,
+//                 tick 0 is the game start
+//     events:     serialized in GameEvent::Format::Binary, exactly as sent
+class Recording final {
+public:
+    // Game block in the mapping. Pointers are valid as long as the recording
+    // is open for reading.
+    struct RecordedGame {
+        uint32_t game_id;
+        uint32_t rounds_per_second;
+        uint32_t events_cnt;
+        uint32_t ticks_cnt;
+        const uint64_t *keyframes;
+        const uint32_t *tick_ends;
+        const char *events;
+    };
+
+    static const uint32_t keyframe_interval;
+
+private:
+    int fd = -1;
+    bool writable = false;
+    char *mapping = nullptr;
+    std::size_t mapping_size = 0;
+    std::size_t used_size = 0;
+
+    std::mutex write_mutex;  // rooms of different workers append games
+    std::vector<RecordedGame> games;  // only when open for reading
+    std::unordered_map<uint32_t, std::size_t> games_by_id;
+
+public:
+    Recording() noexcept = default;
+    Recording(const Recording &recording) = delete;
+    Recording &operator=(const Recording &recording) = delete;
+    ~Recording() noexcept;
+
+    // Opens (and creates if needed) the file for appending games.
+    // Returns false on failure.
+    bool open_for_writing(const std::string &path);
+    // Maps the whole file and indexes its games. Returns false on failure
+    // or if the file is malformed.
+    bool open_for_reading(const std::string &path);
+
+    // Thread safe. tick_ends as in the file layout. Returns false on I/O failure.
+    bool append_game(uint32_t game_id, uint32_t rounds_per_second,
+                     const EventLog &events, const std::vector<uint32_t> &tick_ends);
+
+    std::size_t games_cnt() const noexcept;
+    const RecordedGame &get_game(std::size_t index) const noexcept;
+    // Returns games_cnt() if there is no such game.
+    std::size_t find_game(uint32_t game_id) const noexcept;
+
+    // Finds event with given number (< game.events_cnt) using the nearest keyframe.
+    static const char *find_event(const RecordedGame &game, uint32_t event_no) noexcept;
+    // Finds the longest range of events starting with first_no and ending before
+    // end_no which fits into max_size bytes. Sets data and size to the range,
+    // returns number of the first event which is not in it.
+    static uint32_t events_range(const RecordedGame &game, uint32_t first_no,
+                                 uint32_t end_no, std::size_t max_size,
+                                 const char *&data, std::size_t &size) noexcept;
+
+private:
+    void close_file() noexcept;
+    bool reserve(std::size_t size) noexcept;
+    bool index_games() noexcept;
+};
@@ -0,0 +1,67 @@
+#include <server/Replay.hpp>
+
+#include <cassert>
+
+
+static constexpr uint32_t pause_seconds = 3;  // lets clients see the end of the game
+
+
+Replay::Replay(const Recording &recording, uint32_t speed, std::size_t first_game_index)
+        : recording(recording), speed(speed) {
+    assert(recording.games_cnt() > 0);
+    assert(speed > 0);
+    start_game(first_game_index % recording.games_cnt());
+}
+
+
+bool Replay::update() noexcept {
+    if (tick + 1 < game->ticks_cnt) {
+        tick++;
+        if (!is_in_progress()) {
+            pause_ticks_left = pause_seconds * get_rounds_per_second();
+        }
+    }
+    else if (pause_ticks_left > 0) {
+        pause_ticks_left--;
+    }
+    else {
+        start_game((game_index + 1) % recording.games_cnt());
+        return true;
+    }
+
+    return false;
+}
+
+
+bool Replay::is_in_progress() const noexcept {
+    return tick + 1 < game->ticks_cnt;
+}
+
+
+uint32_t Replay::get_game_id() const noexcept {
+    return game->game_id;
+}
+
+
+uint32_t Replay::get_events_cnt() const noexcept {
+    return game->tick_ends[tick];
+}
+
+
+uint32_t Replay::get_rounds_per_second() const noexcept {
+    return game->rounds_per_second * speed;
+}
+
+
+uint32_t Replay::prepare_events(uint32_t first_no, std::size_t max_size,
+                                const char *&data, std::size_t &size) const noexcept {
+    return Recording::events_range(*game, first_no, get_events_cnt(), max_size, data, size);
+}
+
+
+void Replay::start_game(std::size_t index) noexcept {
+    game_index = index;
+    game = &recording.get_game(index);
+    tick = 0;
+    pause_ticks_left = game->ticks_cnt == 1 ? pause_seconds * get_rounds_per_second() : 0;
+}
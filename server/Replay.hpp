@@ -0,0 +1,43 @@
+#pragma once
+
+#include <server/Recording.hpp>
+
+#include <cstdint>
+
+
+// Plays games from a recording tick by tick, one after another in a loop,
+// for a room in replay mode. Events become visible at the tick they were
+// emitted at in the original game.
+class Replay final {
+private:
+    const Recording &recording;
+    uint32_t speed;  // multiplier of original rounds per second
+
+    std::size_t game_index;
+    const Recording::RecordedGame *game;
+    uint32_t tick = 0;
+    uint32_t pause_ticks_left = 0;  // after game over, before the next game
+
+public:
+    // Recording must be open for reading and contain at least one game.
+    Replay(const Recording &recording, uint32_t speed, std::size_t first_game_index);
+
+    // Moves to the next tick, or the next game after a pause.
+    // Returns true if the next game was started.
+    bool update() noexcept;
+
+    bool is_in_progress() const noexcept;
+    uint32_t get_game_id() const noexcept;
+    // Number of events already visible to clients.
+    uint32_t get_events_cnt() const noexcept;
+    uint32_t get_rounds_per_second() const noexcept;
+
+    // Finds the longest range of visible events starting with first_no which fits
+    // into max_size bytes. Data points into the recording's mapping.
+    // Returns number of the first event which is not in the range.
+    uint32_t prepare_events(uint32_t first_no, std::size_t max_size,
+                            const char *&data, std::size_t &size) const noexcept;
+
+private:
+    void start_game(std::size_t index) noexcept;
+};
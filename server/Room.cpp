@@ -0,0 +1,818 @@
+#include <server/Room.hpp>
+#include <server/Log.hpp>
+#include <common/utils.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <endian.h>
+#include <iomanip>
+
+using namespace std::chrono_literals;
+
+
+static constexpr auto max_connected_clients = 42;
+static constexpr auto max_multicast_observers = 256;  // in addition to the above
+static constexpr auto min_players_number = 2;
+static constexpr auto client_timeout = 2s;
+static constexpr auto receive_batch_capacity = 64;  // datagrams per recvmmsg(2)
+static constexpr auto send_batch_capacity = 64;     // datagrams per sendmmsg(2)
+// Snapshot is sent instead of the history if it is longer than min_events
+// (about a dozen datagrams of pixels). Rebuilt one is never more than max_lag
+// events behind the game.
+static constexpr auto snapshot_min_events = 256;
+static constexpr auto snapshot_max_lag = 1024;
+// Events published to multicast group are sent directly to its member only if
+// they are still missing after that long: a couple of heartbeats on a LAN.
+static constexpr auto multicast_repair_delay = 40ms;
+
+
+Room::Room(const Config &config, uint64_t seed, std::string log_prefix)
+        : config(config), log_prefix(std::move(log_prefix)),
+          receive_batch(receive_batch_capacity), send_batch(send_batch_capacity),
+          clients(max_connected_clients
+                  + (config.multicast_group.empty() ? 0 : max_multicast_observers)),
+          game(config.game, this->log_prefix) {
+    room_state.rand_gen.set_seed(seed);
+    if (config.replay != nullptr) {
+        replay = std::make_unique<Replay>(*config.replay, config.replay_speed, seed);
+    }
+}
+
+
+void Room::init(system_clock::time_point first_update_time) {
+    HostAddress address;
+    if(!address.resolve("::", config.port_number) ||
+            address.get()->ip_version != HostAddress::IpVersion::IPv6 ||
+            socket.init(address.get()->ip_version) != Socket::Status::Done ||
+            socket.bind(address) != Socket::Status::Done ||
+            socket.set_blocking(false) != Socket::Status::Done) {
+        exit_with_error(log_prefix + "Failed to initialize server socket.");
+    }
+
+    if (!config.multicast_group.empty()) {
+        if (!multicast_address.resolve(config.multicast_group, config.multicast_port)
+                || !multicast_address.is_multicast()
+                || multicast_socket.init(multicast_address.get()->ip_version)
+                   != Socket::Status::Done
+                || multicast_socket.set_blocking(false) != Socket::Status::Done) {
+            exit_with_error(log_prefix + "Failed to initialize multicast socket.");
+        }
+    }
+
+    game_state.next_update_time = first_update_time;
+    room_state.outgoing.resize(send_batch.capacity());
+    if (replay) {
+        start_replayed_game();
+    }
+}
+
+
+void Room::process(bool receive_input) {
+    if (game_update_pending()) {
+        update_game_state();
+        publish_events();
+    }
+    check_clients_connections();
+
+    if (receive_input) {
+        handle_clients_input();
+    }
+    send_events_to_clients();
+}
+
+
+bool Room::pending_work() const {
+    if (game_update_pending()) {
+        return true;
+    }
+
+    if (room_state.socket_congested) {
+        return false;
+    }
+
+    auto now = system_clock::now();
+    if (std::any_of(clients.begin(), clients.end(), [this, now](const auto &client) {
+        return (client.next_event_no < get_unicast_end_no(client, now)
+                || client.parity.is_complete()) && client.send_window.can_send(now);
+    })) {
+        return true;
+    }
+
+    // TODO check if data awaiting on sockets (should not make real difference)
+
+    return false;
+}
+
+
+bool Room::game_update_pending() const {
+    return game_state.next_update_time <= system_clock::now();
+}
+
+
+Room::system_clock::time_point Room::get_next_wake_time() const noexcept {
+    auto wake_time = game_state.next_update_time;
+    if (room_state.socket_congested) {
+        return wake_time;
+    }
+
+    auto now = system_clock::now();
+    for (const auto &client : clients) {
+        if (client.next_event_no < get_unicast_end_no(client, now)
+                || client.parity.is_complete()) {
+            wake_time = std::min(wake_time, client.send_window.get_send_time());
+        }
+    }
+    return wake_time;
+}
+
+
+int Room::get_fd() const noexcept {
+    return socket.get_fd();
+}
+
+
+bool Room::is_socket_congested() const noexcept {
+    return room_state.socket_congested;
+}
+
+
+void Room::socket_writable() noexcept {
+    room_state.socket_congested = false;
+}
+
+
+void Room::check_clients_connections() {
+    auto &timed_out = room_state.timed_out_clients;
+    timed_out.clear();
+    room_state.client_timeouts.expire(system_clock::now(), timed_out);
+
+    for (auto client_id : timed_out) {
+        disconnect_client(client_id);
+    }
+}
+
+
+void Room::disconnect_client(ClientId client_id) {
+    auto &client = clients[client_id];
+    LogLine(log_prefix) << log_name(client.name, true) << " disconnected.";
+    room_state.client_timeouts.remove(client.timeout_handle);
+
+    if (room_state.next_client == client_id) {
+        auto next = clients.next_circular(client_id);
+        room_state.next_client = next != client_id ? next : ClientTable::none;
+    }
+    clients.erase(client_id);
+}
+
+
+void Room::handle_clients_input() {
+    uint32_t handled_cnt = 0;
+
+    while (handled_cnt < config.receive_budget && !game_update_pending()) {
+        auto requested_cnt = config.receive_budget - handled_cnt;
+        auto status = socket.receive_batch(receive_batch, requested_cnt);
+        if (status != Socket::Status::Done) {
+            return;  // no data or socket error
+        }
+
+        for (std::size_t i = 0; i < receive_batch.size(); i++) {
+            handle_client_datagram(receive_batch.data(i), receive_batch.data_size(i),
+                                   receive_batch.address(i));
+        }
+
+        handled_cnt += receive_batch.size();
+        if (receive_batch.size() < std::min<std::size_t>(requested_cnt,
+                                                         receive_batch.capacity())) {
+            return;  // socket drained
+        }
+    }
+}
+
+
+void Room::handle_client_datagram(const char *data, std::size_t size,
+                                    const HostAddress::SocketAddress &src_addr) {
+    auto &hb = room_state.input_heartbeat;
+    if (!hb.deserialize(data, size)) {
+        return;
+    }
+
+    auto client_id = handle_client_session(src_addr, hb);
+    if (client_id == ClientTable::none) {
+        return;
+    }
+
+    if (room_state.next_client == ClientTable::none) {
+        room_state.next_client = client_id;
+    }
+
+    auto &client = clients[client_id];
+
+    if (!client.ready_to_play && !replay && !game.is_in_progress()
+            && hb.turn_direction != 0 && !client.name.empty()) {
+        LogLine(log_prefix) << log_name(client.name, true) << " is ready.";
+        client.ready_to_play = true;
+    }
+
+    if (client.player_no != -1) {
+        game.set_turn_direction(client.player_no, hb.turn_direction);
+    }
+}
+
+
+Room::ClientId Room::handle_client_session(
+        const HostAddress::SocketAddress &client_addr, const HeartBeat &hb) {
+    bool new_session = false;
+    AddressKey client_key(client_addr);
+    auto client_id = clients.find(client_key);
+
+    if (client_id == ClientTable::none) {
+        // new client
+        if (clients.full() || (!is_multicast_observer(hb.player_name, hb.capabilities)
+                               && unicast_clients_cnt() >= max_connected_clients)) {
+            // TODO log not too often
+            LogLine(log_prefix) << "Rejecting " << log_name(hb.player_name, false)
+                                << ": maximum number of clients reached.";
+            return ClientTable::none;
+        }
+
+        if (!check_name_availability(hb.player_name)) {
+            // TODO log not too often
+            LogLine(log_prefix) << "Rejecting " << log_name(hb.player_name, false)
+                                << ": name already in use.";
+            return ClientTable::none;
+        }
+
+        LogLine(log_prefix) << log_name(hb.player_name, true) << " connected.";
+        new_session = true;
+
+        client_id = clients.insert(client_key);
+        auto &client = clients[client_id];
+        client.address = client_addr;
+        client.timeout_handle = room_state.client_timeouts.add(
+                client_id, system_clock::now() + client_timeout);
+    }
+    else {
+        // known client
+        auto &client = clients[client_id];
+        // group member becoming a unicast client (player or without the capability)
+        // takes one of the places for them
+        bool no_unicast_place = is_multicast_observer(client.name, client.capabilities)
+                                && !is_multicast_observer(hb.player_name, hb.capabilities)
+                                && unicast_clients_cnt() >= max_connected_clients;
+        if (hb.session_id < client.session_id) {
+            return ClientTable::none;  // old session, dropping
+        }
+        else if (hb.session_id > client.session_id) {
+            if (client.name != hb.player_name && !check_name_availability(hb.player_name)) {
+                // new session with already taken name
+                disconnect_client(client_id);
+                return ClientTable::none;
+            }
+            if (no_unicast_place) {
+                LogLine(log_prefix) << "Rejecting new session of " << log_name(client.name, false)
+                                    << ": maximum number of clients reached.";
+                disconnect_client(client_id);
+                return ClientTable::none;
+            }
+
+            LogLine(log_prefix) << log_name(client.name, true) << " initialized new session as "
+                                << log_name(hb.player_name, false) << ".";
+            new_session = true;
+        }
+        else if (client.name != hb.player_name || no_unicast_place) {
+            return ClientTable::none;  // drop invalid packet
+        }
+    }
+
+    auto &client = clients[client_id];
+    if (new_session) {
+        client.session_id = hb.session_id;
+        client.name = hb.player_name;
+        client.player_no = -1;
+        client.ready_to_play = false;
+        // New clients should ask for event no 0.
+        client.got_new_game_event = true;
+    }
+
+    auto now = system_clock::now();
+    room_state.client_timeouts.reschedule(client.timeout_handle, now + client_timeout);
+    if (new_session) {
+        client.send_window.reset(now, get_rounds_per_second());
+    }
+    bool lost = client.send_window.acknowledge(hb.next_expected_event_no, now)
+                || hb.received_events.any();
+
+    // gaps make sense only if the client follows the game we were sending
+    client.resume_event_no = client.received_end_no = 0;
+    client.received_events.reset();
+    if (hb.received_events.any() && !new_session && client.got_new_game_event) {
+        auto last = hb.received_events.size() - 1;
+        while (!hb.received_events[last]) {
+            last--;
+        }
+
+        client.received_base = hb.next_expected_event_no;
+        client.received_events = hb.received_events;
+        client.received_end_no = client.received_base + 1 + last + 1;
+        client.resume_event_no = client.next_event_no;
+    }
+
+    // Events following the expected one may be still on their way,
+    // they are sent again only if some of them were lost.
+    if (new_session || lost || client.next_event_no < hb.next_expected_event_no) {
+        client.send_window.clear_in_flight();
+        client.next_event_no = hb.next_expected_event_no;
+    }
+    client.capabilities = hb.capabilities;
+    client.next_fragment_no = hb.next_expected_fragment_no;
+    auto parity_group_size = std::min<std::size_t>(hb.parity_group_size, max_parity_group_size);
+    if (new_session || client.parity.get_group_size() != parity_group_size) {
+        client.parity.reset(parity_group_size);
+    }
+
+    return client_id;
+}
+
+
+bool Room::check_name_availability(const std::string &name) const noexcept {
+    return name.empty() || std::all_of(clients.begin(), clients.end(),
+            [&name](const auto &client_session) {
+        return name != client_session.name;
+    });
+}
+
+
+bool Room::is_multicast_observer(const std::string &name, uint32_t capabilities) const noexcept {
+    return multicast_address.get() != nullptr && name.empty()
+           && (capabilities & HeartBeat::Capability::MulticastEvents);
+}
+
+
+std::size_t Room::unicast_clients_cnt() const noexcept {
+    return std::count_if(clients.begin(), clients.end(), [this](const auto &client) {
+        return !is_multicast_observer(client.name, client.capabilities);
+    });
+}
+
+
+void Room::send_events_to_clients() {
+    if (game_update_pending()) {
+        return;
+    }
+
+    send_batch.clear();
+    for (auto batch_size = send_batch.size(); !send_batch.full(); ) {
+        // One round: every client gets at most one datagram.
+        auto clients_num = clients.size();
+        for (std::size_t i = 0; i < clients_num && !send_batch.full(); i++) {
+            enqueue_events_for_next_client();
+        }
+
+        if (batch_size == send_batch.size()) {
+            break;  // no more datagrams to send
+        }
+        batch_size = send_batch.size();
+    }
+
+    if (send_batch.size() == 0) {
+        return;
+    }
+
+    auto status = socket.send_batch(send_batch);
+    // we are intentionally ignoring errors here, except remembering
+    // that there is no point in retrying until the socket is writable
+    room_state.socket_congested = status == Socket::Status::NotReady;
+    game_state.send_syscalls += send_batch.syscalls_cnt();
+
+    // Roll back progress of clients whose datagrams were not sent. Going backwards,
+    // so the earliest unsent datagram of each client wins.
+    auto processed_cnt = send_batch.processed_cnt();
+    for (auto i = send_batch.size(); i-- > 0; ) {
+        auto &datagram = room_state.outgoing[i];
+        if (i < processed_cnt && !send_batch.is_failed(i)) {
+            game_state.datagrams_sent++;
+            continue;
+        }
+
+        auto &client = clients[datagram.client];
+        client.send_window.unsent(datagram.first_event_no, datagram.end_event_no);
+        if (datagram.parity) {
+            continue;  // its group is already gone, lost datagrams are sent again anyway
+        }
+        // The datagram was added to the current group when queued and it will be
+        // added again when resent, start over so parity covers only sent ones.
+        client.parity.reset(client.parity.get_group_size());
+        client.next_event_no = datagram.first_event_no;
+        if (datagram.fragment_no != no_fragment) {
+            client.next_fragment_no = datagram.fragment_no;
+        }
+        if (datagram.first_event_no == 0) {
+            client.got_new_game_event = false;
+        }
+    }
+
+    // Client which did not get its datagram goes first next time.
+    if (processed_cnt < send_batch.size()) {
+        room_state.next_client = room_state.outgoing[processed_cnt].client;
+    }
+}
+
+
+void Room::enqueue_events_for_next_client() {
+    assert(room_state.next_client != ClientTable::none);
+    auto &client = clients[room_state.next_client];
+    if (!client.got_new_game_event) {
+        client.next_event_no = 0;
+        client.received_events.reset();  // they were of the previous game
+        client.resume_event_no = client.received_end_no = 0;
+    }
+
+    auto now = system_clock::now();
+    if (!client.send_window.can_send(now)) {
+        // waits for a token or for a heartbeat making room in the window
+    }
+    else if (client.parity.is_complete()) {
+        // right after its group, so a lost datagram is rebuilt as soon as possible
+        auto &datagram = room_state.outgoing[send_batch.size()];
+        datagram.client = room_state.next_client;
+        datagram.first_event_no = datagram.end_event_no = client.next_event_no;
+        datagram.fragment_no = no_fragment;
+        datagram.parity = true;
+        client.parity.take_datagram(datagram.data);
+        send_batch.add(datagram.data.data(), datagram.data.size(), client.address);
+
+        client.send_window.sent(datagram.first_event_no, datagram.end_event_no, now);
+    }
+    else if (client.next_event_no == 0 && (client.capabilities & HeartBeat::Capability::Snapshots)
+            && prepare_snapshot(client.next_fragment_no == 0)) {
+        // one fragment at a time, the last one moves client to the following events
+        auto fragments_cnt = snapshot_cache.get_datagrams_cnt();
+        if (client.next_fragment_no >= fragments_cnt) {
+            client.next_fragment_no = 0;  // client asks about an older snapshot
+        }
+
+        auto &datagram = room_state.outgoing[send_batch.size()];
+        datagram.client = room_state.next_client;
+        datagram.first_event_no = datagram.end_event_no = 0;
+        datagram.fragment_no = client.next_fragment_no;
+        datagram.parity = false;
+        const auto &data = snapshot_cache.get_datagram(datagram.fragment_no);
+        send_batch.add(data.data(), data.size(), client.address);
+
+        client.send_window.sent(datagram.first_event_no, datagram.end_event_no, now);
+        client.got_new_game_event = true;
+        client.next_fragment_no++;
+        if (client.next_fragment_no == fragments_cnt) {
+            client.next_event_no = snapshot_cache.get_events_cnt();
+        }
+    }
+    else if (client.next_event_no < get_unicast_end_no(client, now)) {
+        auto &datagram = room_state.outgoing[send_batch.size()];
+        datagram.client = room_state.next_client;
+        datagram.first_event_no = client.next_event_no;
+        datagram.fragment_no = no_fragment;
+        datagram.parity = false;
+
+        if (replay) {
+            // zero copy: events are sent straight from the recording's mapping
+            const char *data;
+            std::size_t size;
+            auto &head = game_state.replay_head;
+            datagram.end_event_no = replay->prepare_events(
+                    client.next_event_no, max_datagram_size - sizeof(head), data, size);
+            send_batch.add(reinterpret_cast<const char*>(&head), sizeof(head), data, size,
+                           client.address);
+            client.parity.add(be32toh(head), reinterpret_cast<const char*>(&head), sizeof(head),
+                              data, size);
+        }
+        else {
+            bool compressed = client.capabilities & HeartBeat::Capability::CompressedDatagrams;
+            bool pixel_runs = client.capabilities & HeartBeat::Capability::PixelRuns;
+            auto &cache = datagram_caches[compressed | pixel_runs << 1];
+            const auto &cached = cache.get(game.get_events(), client.next_event_no);
+            datagram.end_event_no = cached.end_event_no;
+            if (enqueue_missing_events(client, datagram, cached.data.size())) {
+                client.parity.add(game.get_game_id(), datagram.data);
+            }
+            else {
+                send_batch.add(cached.data.data(), cached.data.size(), client.address);
+                client.parity.add(game.get_game_id(), cached.data);
+            }
+        }
+
+        // optimistic progress, rolled back if sending fails
+        client.send_window.sent(datagram.first_event_no, datagram.end_event_no, now);
+        client.got_new_game_event = true;
+        client.next_event_no = find_event(client, datagram.end_event_no, false);
+        if (client.received_end_no <= client.next_event_no) {
+            client.next_event_no = std::max(client.next_event_no, client.resume_event_no);
+        }
+    }
+
+    room_state.next_client = clients.next_circular(room_state.next_client);
+}
+
+
+bool Room::enqueue_missing_events(const ClientSession &client, OutgoingDatagram &datagram,
+                                  std::size_t cached_size) {
+    auto received_no = find_event(client, client.next_event_no + 1, true);
+    if (datagram.end_event_no <= received_no) {
+        return false;  // cached datagram has no events received by client
+    }
+
+    const auto &events = game.get_events();
+    auto &gap_events = room_state.gap_events;
+    auto &data = datagram.data;
+    bool compressed = client.capabilities & HeartBeat::Capability::CompressedDatagrams;
+    auto max_size = compressed ? DatagramCompressor::max_input_size
+                               : max_datagram_size - sizeof(uint32_t);  // game_id
+
+    gap_events.clear();
+    auto end_no = client.next_event_no;
+    for (; end_no < received_no && gap_events.size() + events.event_size(end_no) <= max_size;
+         end_no++) {
+        gap_events.append(events.event_data(end_no), events.event_size(end_no));
+    }
+    if (end_no == client.next_event_no) {
+        return false;
+    }
+
+    if (compressed) {
+        end_no = client.next_event_no
+                 + room_state.gap_compressor.prepare_packet(data, game.get_game_id(), gap_events);
+    }
+    else {
+        uint32_t game_id_be = htobe32(game.get_game_id());
+        data.assign(reinterpret_cast<const char*>(&game_id_be), sizeof(game_id_be));
+        data.append(gap_events);
+    }
+
+    if (cached_size <= data.size()) {
+        return false;
+    }
+
+    datagram.end_event_no = end_no;
+    send_batch.add(data.data(), data.size(), client.address);
+    return true;
+}
+
+
+uint32_t Room::find_event(const ClientSession &client, uint32_t event_no, bool received) noexcept {
+    if (client.received_events.none()) {
+        return received ? UINT32_MAX : event_no;
+    }
+
+    // bits cover events [first_no, first_no + max_received_events)
+    const auto first_no = client.received_base + 1;
+    if (event_no < first_no) {
+        if (!received) {
+            return event_no;
+        }
+        event_no = first_no;
+    }
+
+    for (; event_no - first_no < client.received_events.size(); event_no++) {
+        if (client.received_events[event_no - first_no] == received) {
+            return event_no;
+        }
+    }
+    return received ? UINT32_MAX : event_no;
+}
+
+
+void Room::publish_events() {
+    auto events_cnt = get_events_cnt();
+    auto &next_no = multicast_state.next_event_no;
+    if (multicast_address.get() == nullptr || next_no >= events_cnt) {
+        return;
+    }
+
+    // Best effort: members of the group get lost datagrams directly later,
+    // so failures are ignored and nothing is sent again.
+    const auto &address = *multicast_address.get();
+    while (next_no < events_cnt) {
+        send_batch.clear();
+        while (next_no < events_cnt && !send_batch.full()) {
+            if (replay) {
+                const char *data;
+                std::size_t size;
+                auto &head = game_state.replay_head;
+                next_no = replay->prepare_events(next_no, max_datagram_size - sizeof(head),
+                                                 data, size);
+                send_batch.add(reinterpret_cast<const char*>(&head), sizeof(head), data, size,
+                               address);
+            }
+            else {
+                // compressed with pixel runs, all members of the group understand it
+                const auto &cached = datagram_caches[3].get(game.get_events(), next_no);
+                next_no = cached.end_event_no;
+                send_batch.add(cached.data.data(), cached.data.size(), address);
+            }
+        }
+
+        multicast_socket.send_batch(send_batch);
+        game_state.datagrams_published += send_batch.processed_cnt();
+        game_state.send_syscalls += send_batch.syscalls_cnt();
+    }
+
+    auto now = system_clock::now();
+    auto &recent = multicast_state.recent;
+    recent.push_back({next_no, now});
+    while (recent.size() > 1 && recent[1].time + multicast_repair_delay <= now) {
+        recent.pop_front();
+    }
+}
+
+
+uint32_t Room::get_unicast_end_no(const ClientSession &client,
+                                  system_clock::time_point now) const noexcept {
+    if (multicast_address.get() == nullptr
+            || !(client.capabilities & HeartBeat::Capability::MulticastEvents)) {
+        return get_events_cnt();
+    }
+
+    uint32_t end_no = 0;
+    for (const auto &publication : multicast_state.recent) {
+        if (now < publication.time + multicast_repair_delay) {
+            break;
+        }
+        end_no = publication.end_event_no;
+    }
+    return end_no;
+}
+
+
+bool Room::prepare_snapshot(bool may_rebuild) {
+    auto events_cnt = get_events_cnt();
+    if (events_cnt < snapshot_min_events) {
+        return false;
+    }
+
+    while (snapshot_cache.get_consumed_cnt() < events_cnt) {
+        auto first_no = snapshot_cache.get_consumed_cnt();
+        if (replay) {
+            const char *data;
+            std::size_t size;
+            replay->prepare_events(first_no, SIZE_MAX, data, size);
+            snapshot_cache.consume(data, size);
+        }
+        else {
+            const auto &events = game.get_events();
+            snapshot_cache.consume(events.event_data(first_no), events.event_size(first_no));
+        }
+    }
+
+    if (may_rebuild) {
+        snapshot_cache.update(snapshot_max_lag);
+    }
+
+    return snapshot_cache.get_datagrams_cnt() > 0;
+}
+
+
+void Room::log_send_statistics() const {
+    double ticks = std::max<uint64_t>(game_state.ticks, 1);
+    LogLine(log_prefix) << "Sent " << game_state.datagrams_sent << " datagrams in "
+                        << game_state.send_syscalls << " system calls during "
+                        << game_state.ticks << " rounds (" << std::fixed << std::setprecision(2)
+                        << game_state.send_syscalls / ticks << " syscalls per round, "
+                        << game_state.datagrams_sent / ticks << " with one per datagram).";
+    if (multicast_address.get() != nullptr) {
+        LogLine(log_prefix) << "Published " << game_state.datagrams_published
+                            << " datagrams to multicast group.";
+    }
+}
+
+
+uint32_t Room::get_events_cnt() const noexcept {
+    return replay ? replay->get_events_cnt() : game.get_events().size();
+}
+
+
+uint32_t Room::get_rounds_per_second() const noexcept {
+    return replay ? replay->get_rounds_per_second() : config.rounds_per_second;
+}
+
+
+void Room::update_game_state() {
+    game_state.next_update_time += 1'000'000us / get_rounds_per_second();
+
+    if (replay) {
+        update_replay();
+    }
+    else if (game.is_in_progress()) {
+        game_state.ticks++;
+        game.update();
+        game_state.tick_ends.push_back(game.get_events().size());
+        if (!game.is_in_progress()) {
+            log_send_statistics();
+            record_game();
+        }
+    }
+    else {
+        start_new_game_if_possible();
+    }
+}
+
+void Room::start_new_game_if_possible() {
+    uint8_t counter = 0;
+    std::vector<std::string> names;
+
+    // Validate if all clients with non-empty login are ready
+    for (auto &client : clients) {
+        if (client.name.empty()) {
+            continue;
+        }
+
+        if (!client.ready_to_play) {
+            return;
+        }
+
+        counter++;
+        names.push_back(client.name);
+    }
+
+    if (counter < min_players_number) {
+        return;
+    }
+
+    LogLine(log_prefix) << "Starting new game.";
+    game_state.ticks = game_state.datagrams_sent = game_state.send_syscalls = 0;
+    game_state.datagrams_published = 0;
+    game.start(room_state.rand_gen.next(), std::move(names), room_state.rand_gen);
+    for (auto &cache : datagram_caches) {
+        cache.reset(game.get_game_id());
+    }
+    snapshot_cache.reset(game.get_game_id());
+    multicast_state.next_event_no = 0;
+    multicast_state.recent.clear();
+    game_state.tick_ends.assign(1, game.get_events().size());
+    if (!game.is_in_progress()) {
+        record_game();  // game over right at the start
+    }
+
+    // Map clients to players
+    const auto &players = game.get_players();
+    for (auto &client : clients) {
+        client.got_new_game_event = false;
+        client.send_window.clear_in_flight();
+        client.next_fragment_no = 0;
+        client.ready_to_play = false;
+        client.player_no = -1;
+        if (client.name.empty()) {
+            continue;
+        }
+
+        auto it = std::lower_bound(players.begin(), players.end(), client.name,
+                                   [](const auto &player, const auto &name) {
+            return player.name < name;
+        });
+        if (it == players.end() || it->name != client.name) {
+            continue;  // too many players, this one is not lucky
+        }
+
+        client.player_no = it - players.begin();
+    }
+}
+
+
+void Room::record_game() {
+    if (config.recording == nullptr) {
+        return;
+    }
+
+    if (!config.recording->append_game(game.get_game_id(), config.rounds_per_second,
+                                       game.get_events(), game_state.tick_ends)) {
+        LogLine(log_prefix) << "Warning: Failed to record game.";
+    }
+}
+
+
+void Room::update_replay() {
+    bool was_in_progress = replay->is_in_progress();
+    if (replay->update()) {
+        start_replayed_game();
+    }
+    else if (was_in_progress && !replay->is_in_progress()) {
+        LogLine(log_prefix) << "Game over.";
+    }
+}
+
+
+void Room::start_replayed_game() {
+    LogLine(log_prefix) << "Replaying game " << replay->get_game_id() << ".";
+    game_state.replay_head = htobe32(replay->get_game_id());
+    snapshot_cache.reset(replay->get_game_id());
+    multicast_state.next_event_no = 0;
+    multicast_state.recent.clear();
+
+    // everyone is an observer, starting from the NewGame event
+    for (auto &client : clients) {
+        client.got_new_game_event = false;
+        client.send_window.clear_in_flight();
+        client.send_window.set_rounds_per_second(replay->get_rounds_per_second());
+        client.next_fragment_no = 0;
+        client.ready_to_play = false;
+        client.player_no = -1;
+    }
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <server/DatagramCache.hpp>
+#include <server/Game.hpp>
+#include <server/Recording.hpp>
+#include <server/Replay.hpp>
+#include <server/SendWindow.hpp>
+#include <server/SessionTable.hpp>
+#include <server/SnapshotCache.hpp>
+#include <server/TimingWheel.hpp>
+#include <common/RandomNumberGenerator.hpp>
+#include <common/network/UdpSocket.hpp>
+#include <common/protocol/DatagramParity.hpp>
+#include <common/protocol/HeartBeat.hpp>
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <vector>
+
+
+// Single game room: socket, connected clients and the game played by them.
+// Room never blocks, waiting for work is up to the Server's worker running it.
+class Room final {
+public:
+    using system_clock = std::chrono::system_clock;
+
+    struct Config {
+        uint16_t port_number = 12345;
+        uint32_t rounds_per_second = 50;
+        uint32_t receive_budget = 64;  // max datagrams handled per handle_clients_input()
+        Game::Config game;
+        Recording *recording = nullptr;     // if set, finished games are appended to it
+        const Recording *replay = nullptr;  // if set, recorded games are served
+                                            // instead of playing new ones
+        uint32_t replay_speed = 1;          // multiplier of recorded rounds per second
+        std::string multicast_group;        // if set, live events are published to it
+        uint16_t multicast_port = 12347;
+    };
+
+private:
+    Config config;
+    std::string log_prefix;
+
+    // socket
+    UdpSocket socket;
+    UdpSocket::ReceiveBatch receive_batch;  // reused by handle_clients_input()
+    UdpSocket::SendBatch send_batch;        // reused by send_events_to_clients()
+                                            // and publish_events()
+    UdpSocket multicast_socket;             // only if config.multicast_group is set
+    HostAddress multicast_address;
+
+    // represents session of connected client
+    struct ClientSession {
+        HostAddress::SocketAddress address;
+        uint64_t session_id;
+        std::string name;
+
+        int8_t player_no;  // number of players during game, -1 if observer
+        bool got_new_game_event;
+        TimingWheelHandle timeout_handle;  // deadline is last heartbeat + timeout
+        bool ready_to_play;
+        uint32_t next_event_no;
+        uint32_t capabilities;     // HeartBeat::Capability bits
+        uint32_t next_fragment_no; // of snapshot, used while next_event_no is 0
+        // Reported by the last heartbeat, see HeartBeat::received_events. Events
+        // following the last received one were sent already, so after the gaps
+        // are filled sending continues with resume_event_no.
+        uint32_t received_base;  // its next_expected_event_no
+        std::bitset<HeartBeat::max_received_events> received_events;
+        uint32_t received_end_no;  // one after the last received event
+        uint32_t resume_event_no;
+        SendWindow send_window;  // paces datagrams, see send_events_to_clients()
+        ParityEncoder parity;    // of event datagrams sent to client, if it wants them
+    };
+
+    // for fast lookups and fair iterating through all clients
+    using ClientTable = SessionTable<ClientSession>;
+    using ClientId = ClientTable::Id;
+    ClientTable clients;
+
+    // datagram put into send_batch, data lives in one of the caches
+    struct OutgoingDatagram {
+        ClientId client;
+        uint32_t first_event_no;
+        uint32_t end_event_no;
+        uint32_t fragment_no;  // of snapshot, no_fragment if datagram has events
+        bool parity;           // parity datagram, it is not sent again if sending fails
+        std::string data;      // if built just for this client, see enqueue_missing_events()
+    };
+    static constexpr uint32_t no_fragment = UINT32_MAX;
+
+    // game state
+    Game game;
+    // one per datagram format, indexed by compressed | pixel_runs << 1
+    std::array<DatagramCache, 4> datagram_caches{{
+            DatagramCache(false, false), DatagramCache(true, false),
+            DatagramCache(false, true), DatagramCache(true, true)}};
+    SnapshotCache snapshot_cache;  // for clients joining in the middle of a game
+    std::unique_ptr<Replay> replay;  // only in replay mode
+    struct {
+        system_clock::time_point next_update_time = system_clock::now();
+        std::vector<uint32_t> tick_ends;  // for recording, see Recording
+        uint32_t replay_head;  // game_id in network byte order, sent before replayed events
+
+        // statistics of the current game, logged at game over
+        uint64_t ticks = 0;
+        uint64_t datagrams_sent = 0;
+        uint64_t datagrams_published = 0;  // to multicast group
+        uint64_t send_syscalls = 0;
+    } game_state;
+
+    // events of the current game published to multicast group
+    struct Publication {
+        uint32_t end_event_no;
+        system_clock::time_point time;
+    };
+    struct {
+        uint32_t next_event_no = 0;  // events before it were published
+        // The oldest one is already repairable, others may be still on their way.
+        std::deque<Publication> recent;
+    } multicast_state;
+
+    // room state
+    struct {
+        RandomNumberGenerator rand_gen;
+        ClientId next_client = ClientTable::none;  // who will get game events updates
+                                                   // if waiting for any
+        // granularity is much finer than client timeout, wheel spans ~2.5 s
+        TimingWheel<ClientId> client_timeouts{std::chrono::milliseconds(10), 256};
+        std::vector<ClientId> timed_out_clients;  // reused buffer
+        HeartBeat input_heartbeat;
+        std::vector<OutgoingDatagram> outgoing;  // first send_batch.size() are in use
+        bool socket_congested = false;  // last send failed, because socket was not ready
+        std::string gap_events;  // reused buffer
+        DatagramCompressor gap_compressor;
+    } room_state;
+
+
+public:
+    // log_prefix is put at the beginning of every logged line
+    Room(const Config &config, uint64_t seed, std::string log_prefix);
+    Room(const Room &room) = delete;
+    Room &operator=(const Room &room) = delete;
+
+    // Binds socket, exits on failure. Rooms of one worker should share
+    // first_update_time, so their updates are due at the same moments.
+    void init(system_clock::time_point first_update_time);
+    // Does all work which can be done without waiting: game update if it is due,
+    // handling clients input and sending a batch of events. Worker which knows
+    // that the socket is not readable can skip receiving with receive_input = false.
+    void process(bool receive_input = true);
+    // True if process() should be called again without waiting.
+    bool pending_work() const;
+    bool game_update_pending() const;
+    // Time at which process() has some work even if nothing is received:
+    // game update is due or a paced client can get its next datagram.
+    system_clock::time_point get_next_wake_time() const noexcept;
+
+    int get_fd() const noexcept;
+    // True if the last send failed, because socket was not ready.
+    // Worker should wait until the socket is writable and call socket_writable().
+    bool is_socket_congested() const noexcept;
+    void socket_writable() noexcept;
+
+private:
+    // Disconnects clients which timed out. Only expired sessions are touched.
+    void check_clients_connections();
+    // Takes care of room_state.next_client
+    void disconnect_client(ClientId client_id);
+    void handle_clients_input();
+    void handle_client_datagram(const char *data, std::size_t size,
+                                const HostAddress::SocketAddress &src_addr);
+    // Returns ClientTable::none if datagram should be dropped.
+    ClientId handle_client_session(const HostAddress::SocketAddress &client_addr,
+                                   const HeartBeat &hb);
+    bool check_name_availability(const std::string &name) const noexcept;
+    // True if client gets live events only through multicast group,
+    // these do not count against max_connected_clients.
+    bool is_multicast_observer(const std::string &name, uint32_t capabilities) const noexcept;
+    std::size_t unicast_clients_cnt() const noexcept;
+    // Sends new events of the game to multicast group, if it is set.
+    void publish_events();
+    // Number of events client can get directly: for members of multicast group
+    // only these which had enough time to arrive through it, so the rest of them
+    // are sent only if client's heartbeat reports them missing.
+    uint32_t get_unicast_end_no(const ClientSession &client,
+                                system_clock::time_point now) const noexcept;
+    void send_events_to_clients();
+    // Puts one datagram for room_state.next_client into send_batch,
+    // if the client is waiting for any events.
+    void enqueue_events_for_next_client();
+    // If cached datagram (of given size, covering datagram's events) would repeat
+    // events client reported as received, puts into send_batch a datagram of only
+    // the missing events preceding them and returns true, unless it is not smaller.
+    bool enqueue_missing_events(const ClientSession &client, OutgoingDatagram &datagram,
+                                std::size_t cached_size);
+    // Returns the first event starting with event_no, which was received by client
+    // (UINT32_MAX if none is known) or was not, according to its last heartbeat.
+    static uint32_t find_event(const ClientSession &client, uint32_t event_no,
+                               bool received) noexcept;
+    // Brings snapshot_cache up to date with the game, rebuilding outdated datagrams
+    // only if may_rebuild. Returns true if there is a snapshot worth sending.
+    bool prepare_snapshot(bool may_rebuild);
+    void log_send_statistics() const;
+    // Number of events clients can get.
+    uint32_t get_events_cnt() const noexcept;
+    // Of the game being played or replayed.
+    uint32_t get_rounds_per_second() const noexcept;
+
+    void update_game_state();
+    void start_new_game_if_possible();
+    void record_game();
+    void update_replay();
+    void start_replayed_game();
+};
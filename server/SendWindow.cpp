@@ -0,0 +1,132 @@
+#include <server/SendWindow.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std::chrono_literals;
+
+
+// Up to date client needs up to 2 full datagrams per round (a pixel of each
+// of 42 players in plain events), the rate leaves as much again for catching
+// up and at least ~1 MB/s of full datagrams at low rounds per second.
+static constexpr double datagrams_per_round = 4;
+static constexpr double min_pacing_rate = 2000;  // datagrams per second
+static constexpr double burst_duration = 0.008;  // seconds of pacing rate
+static constexpr double min_burst_size = 16;     // datagrams
+static constexpr std::size_t min_window = 8;
+// datagram is considered lost after retransmission timeout, like in TCP
+static constexpr auto initial_timeout = 200ms;
+static constexpr auto min_timeout = 10ms;
+
+constexpr std::size_t SendWindow::max_in_flight;
+
+
+void SendWindow::reset(system_clock::time_point now, uint32_t rounds_per_second) noexcept {
+    set_rounds_per_second(rounds_per_second);
+    first = in_flight_cnt = 0;
+    srtt = rttvar = system_clock::duration::zero();
+    tokens = burst_size;
+    refill_time = now;
+}
+
+
+void SendWindow::set_rounds_per_second(uint32_t rounds_per_second) noexcept {
+    pacing_rate = std::max(min_pacing_rate, rounds_per_second * datagrams_per_round);
+    burst_size = std::max(min_burst_size, pacing_rate * burst_duration);
+    tokens = std::min(tokens, burst_size);
+}
+
+
+bool SendWindow::can_send(system_clock::time_point now) const noexcept {
+    return in_flight_cnt < get_window() && available_tokens(now) >= 1;
+}
+
+
+SendWindow::system_clock::time_point SendWindow::get_send_time() const noexcept {
+    if (in_flight_cnt >= get_window()) {
+        return system_clock::time_point::max();
+    }
+
+    if (tokens >= 1) {
+        return refill_time;
+    }
+    // rounded up (and a tick more), so can_send() is true at the returned time
+    // even if tokens are off by floating point error
+    auto wait = std::chrono::duration<double>((1 - tokens) / pacing_rate);
+    return refill_time + std::chrono::duration_cast<system_clock::duration>(wait)
+           + system_clock::duration(1);
+}
+
+
+void SendWindow::sent(uint32_t first_no, uint32_t end_no, system_clock::time_point now) noexcept {
+    tokens = available_tokens(now) - 1;
+    refill_time = now;
+
+    if (first_no < end_no) {
+        assert(in_flight_cnt < max_in_flight);
+        in_flight[(first + in_flight_cnt++) % max_in_flight] = {end_no, now};
+    }
+}
+
+
+void SendWindow::unsent(uint32_t first_no, uint32_t end_no) noexcept {
+    tokens = std::min(tokens + 1, burst_size);
+    if (first_no < end_no) {
+        assert(in_flight_cnt > 0);
+        in_flight_cnt--;
+    }
+}
+
+
+bool SendWindow::acknowledge(uint32_t next_expected_event_no,
+                             system_clock::time_point now) noexcept {
+    bool acknowledged = false;
+    system_clock::time_point sent_time;
+    while (in_flight_cnt > 0 && in_flight[first].end_event_no <= next_expected_event_no) {
+        acknowledged = true;
+        sent_time = in_flight[first].time;
+        first = (first + 1) % max_in_flight;
+        in_flight_cnt--;
+    }
+
+    if (acknowledged) {
+        auto rtt = now - sent_time;
+        if (srtt == system_clock::duration::zero()) {
+            srtt = rtt;
+            rttvar = rtt / 2;
+        }
+        else {
+            rttvar = (rttvar * 3 + (srtt > rtt ? srtt - rtt : rtt - srtt)) / 4;
+            srtt = (srtt * 7 + rtt) / 8;
+        }
+    }
+
+    return in_flight_cnt == 0 || in_flight[first].time + get_timeout() <= now;
+}
+
+
+void SendWindow::clear_in_flight() noexcept {
+    first = in_flight_cnt = 0;
+}
+
+
+double SendWindow::available_tokens(system_clock::time_point now) const noexcept {
+    std::chrono::duration<double> elapsed = now - refill_time;
+    return std::min(tokens + elapsed.count() * pacing_rate, burst_size);
+}
+
+
+std::size_t SendWindow::get_window() const noexcept {
+    // bandwidth-delay product
+    std::chrono::duration<double> rtt = srtt;
+    auto window = static_cast<std::size_t>(rtt.count() * pacing_rate);
+    return std::max(min_window, std::min(window, max_in_flight));
+}
+
+
+SendWindow::system_clock::duration SendWindow::get_timeout() const noexcept {
+    if (srtt == system_clock::duration::zero()) {
+        return initial_timeout;
+    }
+    return std::max<system_clock::duration>(min_timeout, srtt + 4 * rttvar);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+
+// Flow control of datagrams sent to a single client. Token bucket paces them
+// and only about a round trip worth of them is in flight (sent, but events are
+// not acknowledged by a heartbeat yet), so client catching up with the game is
+// not flooded with datagrams overflowing its socket buffer.
+//
+// Round trip time is estimated from heartbeats: the time since sending
+// the latest datagram they acknowledge. It includes waiting for the client's
+// next heartbeat, which is fine, since only heartbeats make room in the window.
+class SendWindow final {
+public:
+    using system_clock = std::chrono::system_clock;
+
+private:
+    static constexpr std::size_t max_in_flight = 64;
+
+    struct Sent {
+        uint32_t end_event_no;  // acknowledged by heartbeat expecting it or later one
+        system_clock::time_point time;
+    };
+
+    std::array<Sent, max_in_flight> in_flight;  // ring buffer, the oldest one first
+    std::size_t first = 0;
+    std::size_t in_flight_cnt = 0;
+
+    // smoothed round trip time and its variation, like in TCP (RFC 6298)
+    system_clock::duration srtt = system_clock::duration::zero();  // zero if unknown
+    system_clock::duration rttvar = system_clock::duration::zero();
+
+    double pacing_rate = 0;  // datagrams per second, follows rounds per second
+    double burst_size = 0;   // the most tokens
+    double tokens = 0;
+    system_clock::time_point refill_time;
+
+public:
+    // Forgets everything about previous datagrams, e.g. of a new session.
+    void reset(system_clock::time_point now, uint32_t rounds_per_second) noexcept;
+    // Adjusts pacing to the game's speed.
+    void set_rounds_per_second(uint32_t rounds_per_second) noexcept;
+
+    // True if datagram can be sent now.
+    bool can_send(system_clock::time_point now) const noexcept;
+    // Time since which can_send() will be true, unless it waits for a heartbeat
+    // to make room in the window (then it returns time_point::max()).
+    system_clock::time_point get_send_time() const noexcept;
+
+    // Takes a token for datagram with events [first_no, end_no), which are
+    // in flight until acknowledged. Snapshot fragments (first_no == end_no)
+    // only take a token.
+    void sent(uint32_t first_no, uint32_t end_no, system_clock::time_point now) noexcept;
+    // Gives back what the last sent() took, datagram turned out to be not sent.
+    void unsent(uint32_t first_no, uint32_t end_no) noexcept;
+
+    // Handles heartbeat of client expecting given event. Returns true if sending
+    // should go back to it: its datagram should have been acknowledged by now
+    // (it was lost) or nothing is in flight. Otherwise it is still on its way.
+    bool acknowledge(uint32_t next_expected_event_no, system_clock::time_point now) noexcept;
+    // Forgets datagrams in flight, they are going to be sent again.
+    void clear_in_flight() noexcept;
+
+private:
+    double available_tokens(system_clock::time_point now) const noexcept;
+    std::size_t get_window() const noexcept;
+    system_clock::duration get_timeout() const noexcept;
+};
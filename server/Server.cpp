@@ -1,11 +1,11 @@
 #include <server/Server.hpp>
 #include <common/utils.hpp>
-#include <common/protocol/MultipleGameEvent.hpp>
+#include <common/network/Poller.hpp>
+#include <common/network/Timer.hpp>
 
 #include <algorithm>
-#include <cassert>
-#include <cmath>
 #include <cstring>
+#include <ctime>
 #include <thread>
 
 using namespace std::chrono_literals;
@@ -14,23 +14,22 @@ using namespace std::chrono_literals;
 static constexpr auto max_rounds_per_second = 1'000;
 static constexpr auto max_map_dimension = 10'000;
 static constexpr auto max_turning_speed = 359;
-
-static constexpr auto deg_to_rad = M_PI / 180.;
-static constexpr auto max_connected_clients = 42;
-static constexpr auto min_players_number = 2;
-static constexpr auto client_timeout = 2s;
-
-template<typename T, typename It>
-static It advance_iterator_circularly(T &container, It it);
-static std::string log_name(const std::string &name, bool capitalized);
+static constexpr auto max_receive_budget = 4096;
+static constexpr auto max_rooms_number = 1'000;
+static constexpr auto max_workers_number = 256;
+static constexpr auto max_replay_speed = 100;
 
 
 Server::Server(int argc, char *argv[]) {
+    config.seed = time(nullptr);
     parse_arguments(argc, argv);
 }
 
 
 void Server::parse_arguments(int argc, char *argv[]) {
+    auto &room_config = config.room;
+    auto &game_config = config.room.game;
+
     for (auto i = 1; i < argc; i += 2) {
         if (strlen(argv[i]) != 2 || argv[i][0] != '-') {
             print_usage(argv[0]);
@@ -38,7 +37,9 @@ void Server::parse_arguments(int argc, char *argv[]) {
         }
 
         auto opt = argv[i][1];
-        if (opt != 'W' && opt != 'H' && opt != 'p' && opt != 's' && opt != 't' && opt != 'r') {
+        if (opt != 'W' && opt != 'H' && opt != 'p' && opt != 's' && opt != 't' && opt != 'r'
+                && opt != 'e' && opt != 'b' && opt != 'g' && opt != 'w' && opt != 'm'
+                && opt != 'o' && opt != 'R' && opt != 'a' && opt != 'M' && opt != 'P') {
             print_usage(argv[0]);
             exit_with_error("Unknown option: " + std::string(argv[i]));
         }
@@ -51,33 +52,79 @@ void Server::parse_arguments(int argc, char *argv[]) {
         try {
             switch (opt) {
                 case 'W':
-                    config.map_width = to_number<decltype(config.map_width)>(
+                    game_config.map_width = to_number<decltype(game_config.map_width)>(
                             "-W", argv[i + 1], 1, max_map_dimension);
                     break;
 
                 case 'H':
-                    config.map_height = to_number<decltype(config.map_height)>(
+                    game_config.map_height = to_number<decltype(game_config.map_height)>(
                             "-H", argv[i + 1], 1, max_map_dimension);
                     break;
 
                 case 'p':
-                    config.port_number = to_number<decltype(config.port_number)>(
+                    room_config.port_number = to_number<decltype(room_config.port_number)>(
                             "-p", argv[i + 1], HostAddress::min_port, HostAddress::max_port);
                     break;
 
                 case 's':
-                    config.rounds_per_second = to_number<decltype(config.rounds_per_second)>(
+                    room_config.rounds_per_second = to_number<decltype(room_config.rounds_per_second)>(
                             "-s", argv[i + 1], 1, max_rounds_per_second);
                     break;
 
                 case 't':
-                    config.turning_speed = to_number<decltype(config.turning_speed)>(
+                    game_config.turning_speed = to_number<decltype(game_config.turning_speed)>(
                             "-t", argv[i + 1], 1, max_turning_speed);
                     break;
 
                 case 'r':
-                    auto seed = to_number<uint64_t>("-r", argv[i + 1]);
-                    server_state.rand_gen.set_seed(seed);
+                    config.seed = to_number<uint64_t>("-r", argv[i + 1]);
+                    break;
+
+                case 'b':
+                    room_config.receive_budget = to_number<decltype(room_config.receive_budget)>(
+                            "-b", argv[i + 1], 1, max_receive_budget);
+                    break;
+
+                case 'g':
+                    config.rooms_number = to_number<decltype(config.rooms_number)>(
+                            "-g", argv[i + 1], 1, max_rooms_number);
+                    break;
+
+                case 'w':
+                    config.workers_number = to_number<decltype(config.workers_number)>(
+                            "-w", argv[i + 1], 1, max_workers_number);
+                    break;
+
+                case 'e':
+                    config.event_loop = to_number<int>("-e", argv[i + 1], 0, 1) == 1
+                                        ? EventLoop::Epoll : EventLoop::Polling;
+                    break;
+
+                case 'm':
+                    game_config.movement = to_number<int>("-m", argv[i + 1], 0, 1) == 1
+                                           ? Game::Movement::FixedPoint : Game::Movement::Double;
+                    break;
+
+                case 'o':
+                    config.record_path = argv[i + 1];
+                    break;
+
+                case 'R':
+                    config.replay_path = argv[i + 1];
+                    break;
+
+                case 'a':
+                    room_config.replay_speed = to_number<decltype(room_config.replay_speed)>(
+                            "-a", argv[i + 1], 1, max_replay_speed);
+                    break;
+
+                case 'M':
+                    room_config.multicast_group = argv[i + 1];
+                    break;
+
+                case 'P':
+                    room_config.multicast_port = to_number<decltype(room_config.multicast_port)>(
+                            "-P", argv[i + 1], HostAddress::min_port, HostAddress::max_port);
                     break;
             }
         }
@@ -86,523 +133,256 @@ void Server::parse_arguments(int argc, char *argv[]) {
             exit_with_error(exc.what());
         }
     }
+
+    if (room_config.port_number + config.rooms_number - 1 > HostAddress::max_port) {
+        print_usage(argv[0]);
+        exit_with_error("Not enough ports for all rooms.");
+    }
+
+    if (!room_config.multicast_group.empty()
+            && room_config.multicast_port + config.rooms_number - 1 > HostAddress::max_port) {
+        print_usage(argv[0]);
+        exit_with_error("Not enough multicast ports for all rooms.");
+    }
+
+    if (!config.record_path.empty() && !config.replay_path.empty()) {
+        print_usage(argv[0]);
+        exit_with_error("Options -o and -R can not be used together.");
+    }
+
+    if (config.workers_number == 0) {
+        config.workers_number = std::max(1u, std::thread::hardware_concurrency());
+    }
+    config.workers_number = std::min(config.workers_number, config.rooms_number);
 }
 
 
 void Server::print_usage(const char *name) const noexcept {
-    std::cerr << "Usage: " << name << " [-W n] [-H n] [-p n] [-s n] [-t n] [-r n]" << std::endl;
+    std::cerr << "Usage: " << name << " [-W n] [-H n] [-p n] [-s n] [-t n] [-r n] [-e 0|1] [-b n]"
+              << " [-g n] [-w n] [-m 0|1] [-o file] [-R file] [-a n] [-M group] [-P n]"
+              << std::endl
+              << "  -b  max datagrams received per loop iteration (default 64)" << std::endl
+              << "  -e  event loop: 0 - polling with sleeps (default), 1 - epoll" << std::endl
+              << "  -g  number of game rooms, room i listens on port p + i (default 1)" << std::endl
+              << "  -w  number of worker threads (default one per core)" << std::endl
+              << "  -m  movement: 0 - double precision (default), 1 - fixed point" << std::endl
+              << "  -o  append finished games to recording file" << std::endl
+              << "  -R  replay mode: serve games from recording file in a loop" << std::endl
+              << "  -a  replay speed, multiplier of recorded rounds per second (default 1)"
+              << std::endl
+              << "  -M  publish live events to IPv4/IPv6 multicast group, for clients joining it"
+              << std::endl
+              << "  -P  multicast port, room i publishes to port P + i (default 12347)"
+              << std::endl;
 }
 
 
 void Server::run() {
-    // Loop design:
+    // Loop design (of every worker):
+    //
+    //    * Room::process() does all work of a room which does not need waiting:
+    //      game update if it is due, then handling input and sending events.
+    //      Rooms are processed only when they may have something to do.
     //
-    //    * handle_clients_input() and send_events_to_clients() does at most one network
-    //      I/O, so work is balanced between receiving input (+ client session management)
-    //      and sending events to clients.
+    //    * Room::handle_clients_input() drains a batch of datagrams (recvmmsg) limited
+    //      by receive_budget, so a flood of heartbeats can not delay game update,
+    //      and Room::send_events_to_clients() hands a batch of datagrams to the kernel
+    //      with a single sendmmsg. This way work is balanced between receiving input
+    //      (+ client session management) and sending events to clients.
     //
-    //    * send_events_to_clients() sends only one datagram to client and iterates
-    //      to a next one. This way, in case of long game and a new client joining
-    //      the server, this client does not have higher priority. In fact, all clients
-    //      have the same priority.
+    //    * Room::send_events_to_clients() fills the batch in rounds, each giving one
+    //      datagram to every waiting client starting from next_client. This way, in case
+    //      of long game and a new client joining the server, this client does not have
+    //      higher priority. In fact, all clients have the same priority.
+    //      Datagrams of every client are paced by its SendWindow, so a client
+    //      catching up with the game is not flooded until its next heartbeat.
+    //
+    //    * with a multicast group (-M), Room::publish_events() sends new events to it
+    //      right after the game update, once for all members of the group. They get
+    //      only catch-up and lost events directly, as requested by their heartbeats.
     //
     //    * if there is no work to do (i.a. datagrams to be send and pending game update),
-    //      the server sleeps for a while to avoid burning CPU cycles uselessly.
+    //      the worker waits to avoid burning CPU cycles uselessly. In EventLoop::Polling
+    //      it sleeps for 1ms, in EventLoop::Epoll it blocks until a datagram arrives,
+    //      the earliest game update or paced datagram is due (timerfd) or a congested
+    //      socket becomes writable again. New datagrams to be sent appear only after
+    //      receiving a heartbeat, updating the game or when pacing allows them,
+    //      so nothing else can wake us up.
     //
-    // Note: in case for UPDATES_PER_SECOND = 1 and tests for exactly 2s timeout, clients
-    //       timeouts are being checked in check_clients_connections() and before sending
-    //       datagram in send_events_to_clients(). In fact, one of these methods would be
-    //       enough, preferably the lazy one (in send_events_to_clients()).
+    // Note: clients timeouts are kept in a timing wheel and checked in every
+    //       Room::process() call, which happens at least once per round. The check
+    //       only touches clients whose deadline passed, so it is cheap even if
+    //       the room is processed many times per round.
 
     init_server();
 
-    while (true) {
-        check_clients_connections();
-        do {
-            handle_clients_input();
-            send_events_to_clients();
-
-            if (!pending_work()) {
-                std::this_thread::sleep_for(1ms);  // sleep a little bit if no more work
-            }
-        } while (!game_update_pending());
-
-        update_game_state();
-    }
-}
-
-
-void Server::init_server() {
-    std::cout << "------------- Server configuration -------------" << std::endl
-              << "         Dimensions: " << config.map_width << " x " << config.map_height << std::endl
-              << "  Rounds per second: " << config.rounds_per_second << std::endl
-              << "      Turning speed: " << config.turning_speed << std::endl
-              << "        Server port: " << config.port_number << std::endl
-              << "        Random seed: " << server_state.rand_gen.peek() << std::endl
-              << "------------------------------------------------" << std::endl
-              << std::endl;
-
-    HostAddress address;
-    if(!address.resolve("::", config.port_number) ||
-            address.get()->ip_version != HostAddress::IpVersion::IPv6 ||
-            socket.init(address.get()->ip_version) != Socket::Status::Done ||
-            socket.bind(address) != Socket::Status::Done ||
-            socket.set_blocking(false) != Socket::Status::Done) {
-        exit_with_error("Failed to initialize server socket.");
+    std::vector<std::thread> workers;
+    for (uint32_t worker_no = 1; worker_no < config.workers_number; worker_no++) {
+        workers.emplace_back(&Server::run_worker, this, worker_no);
     }
 
-    game_state.map.resize(config.map_height * config.map_width);
-    server_state.next_client = server_state.clients.begin();
+    run_worker(0);
 }
 
 
-void Server::check_clients_connections() {
-    auto it = server_state.clients.begin();
-    auto now = std::chrono::system_clock::now();
-
-    while (it != server_state.clients.end()) {
-        auto next = it;
-        next++;
-        if (it->second.last_heartbeat_time + client_timeout < now) {
-            disconnect_client(it);
+void Server::init_server() {
+    if (!config.record_path.empty()) {
+        if (!recording.open_for_writing(config.record_path)) {
+            exit_with_error("Failed to open recording file for writing.");
         }
-
-        it = next;
-    }
-}
-
-
-void Server::disconnect_client(Server::ClientContainer::iterator client) {
-    std::cout << log_name(client->second.name, true) << " disconnected." << std::endl;
-
-    bool replace_next = server_state.next_client == client;
-    client = server_state.clients.erase(client);
-    if (replace_next) {
-        server_state.next_client = client == server_state.clients.end()
-                                   ? client = server_state.clients.begin() : client;
-    }
-}
-
-
-void Server::handle_clients_input() {
-    if (game_update_pending()) {
-        return;
-    }
-
-    HostAddress client_addr;
-    std::string buffer;
-
-    auto status = socket.receive(buffer, client_addr);
-    if (status != Socket::Status::Done) {
-        return;  // no data or socket error
-    }
-
-    HeartBeat hb;
-    if (!hb.deserialize(buffer)) {
-        return;
+        config.room.recording = &recording;
     }
 
-    auto client_it = handle_client_session(client_addr, hb);
-    if (client_it == server_state.clients.end()) {
-        return;
+    if (!config.replay_path.empty()) {
+        if (!recording.open_for_reading(config.replay_path)) {
+            exit_with_error("Failed to open recording file or it is malformed.");
+        }
+        if (recording.games_cnt() == 0) {
+            exit_with_error("Recording file does not contain any games.");
+        }
+        config.room.replay = &recording;
     }
 
-    if (server_state.clients.size() == 1) {
-        server_state.next_client = server_state.clients.begin();
+    const auto &room_config = config.room;
+    const auto &game_config = config.room.game;
+    std::cout << "------------- Server configuration -------------" << std::endl
+              << "         Dimensions: " << game_config.map_width << " x "
+                                         << game_config.map_height << std::endl
+              << "  Rounds per second: " << room_config.rounds_per_second << std::endl
+              << "      Turning speed: " << game_config.turning_speed << std::endl
+              << "           Movement: " << (game_config.movement == Game::Movement::FixedPoint
+                                             ? "fixed point" : "double") << std::endl
+              << "        Server port: " << room_config.port_number;
+    if (config.rooms_number > 1) {
+        std::cout << "-" << room_config.port_number + config.rooms_number - 1;
     }
-
-    auto &client = client_it->second;
-
-    if (!client.ready_to_play && !game_state.game_in_progress
-            && hb.turn_direction != 0 && !client.name.empty()) {
-        std::cout << log_name(client.name, true) << " is ready." << std::endl;
-        client.ready_to_play = true;
+    std::cout << std::endl
+              << "        Random seed: " << config.seed << std::endl
+              << "         Event loop: " << (config.event_loop == EventLoop::Epoll
+                                             ? "epoll" : "polling") << std::endl
+              << "     Receive budget: " << room_config.receive_budget << std::endl
+              << "              Rooms: " << config.rooms_number << std::endl
+              << "            Workers: " << config.workers_number << std::endl;
+    if (!config.record_path.empty()) {
+        std::cout << "          Recording: " << config.record_path << std::endl;
     }
-
-    if (client.player_no != -1) {
-        game_state.players[client.player_no].turn_direction = hb.turn_direction;
+    if (!config.replay_path.empty()) {
+        std::cout << "             Replay: " << config.replay_path << " ("
+                  << recording.games_cnt() << " games, speed x"
+                  << room_config.replay_speed << ")" << std::endl;
     }
-}
-
-
-Server::ClientContainer::iterator Server::handle_client_session(
-        const HostAddress &client_addr, const HeartBeat &hb) {
-    bool new_session = false;
-    auto client_it = server_state.clients.find(client_addr);
-
-    if (client_it == server_state.clients.end()) {
-        // new client
-        if (server_state.clients.size() >= max_connected_clients) {
-            // TODO log not too often
-            std::cout << "Rejecting " << log_name(hb.player_name, false)
-                      << ": maximum number of clients reached." << std::endl;
-            return server_state.clients.end();
-        }
-
-        if (!check_name_availability(hb.player_name)) {
-            // TODO log not too often
-            std::cout << "Rejecting " << log_name(hb.player_name, false)
-                      << ": name already in use." << std::endl;
-            return server_state.clients.end();
-        }
-
-        std::cout << log_name(hb.player_name, true) << " connected." << std::endl;
-        new_session = true;
-
-        auto &client = server_state.clients[client_addr];
-        client.address.set(*client_addr.get());
-        client_it = server_state.clients.find(client_addr);
-    }
-    else {
-        // known client
-        auto &client = client_it->second;
-        if (hb.session_id < client.session_id) {
-            return server_state.clients.end();  // old session, dropping
-        }
-        else if (hb.session_id > client.session_id) {
-            if (client.name != hb.player_name && !check_name_availability(hb.player_name)) {
-                // new session with already taken name
-                disconnect_client(client_it);
-                return server_state.clients.end();
-            }
-
-            std::cout << log_name(client.name, true) << " initialized new session as "
-                      << log_name(hb.player_name, false) << "." << std::endl;
-            new_session = true;
-        }
-        else if (client.name != hb.player_name) {
-            return server_state.clients.end();  // drop invalid packet
+    if (!room_config.multicast_group.empty()) {
+        std::cout << "    Multicast group: " << room_config.multicast_group << " port "
+                  << room_config.multicast_port;
+        if (config.rooms_number > 1) {
+            std::cout << "-" << room_config.multicast_port + config.rooms_number - 1;
         }
+        std::cout << std::endl;
     }
+    std::cout << "------------------------------------------------" << std::endl
+              << std::endl;
 
-    auto &client = client_it->second;
-    if (new_session) {
-        client.session_id = hb.session_id;
-        client.name = hb.player_name;
-        client.player_no = -1;
-        client.ready_to_play = false;
-        // New clients should ask for event no 0.
-        client.got_new_game_event = true;
+    auto first_update_time = Room::system_clock::now();
+    for (uint32_t room_no = 0; room_no < config.rooms_number; room_no++) {
+        auto room_config = config.room;
+        room_config.port_number += room_no;
+        room_config.multicast_port += room_no;
+        auto log_prefix = config.rooms_number == 1
+                          ? "" : "[room " + std::to_string(room_no) + "] ";
+
+        rooms.emplace_back(std::make_unique<Room>(room_config, config.seed + room_no,
+                                                  std::move(log_prefix)));
+        rooms.back()->init(first_update_time);
     }
-
-    client.last_heartbeat_time = std::chrono::system_clock::now();
-    client.next_event_no = hb.next_expected_event_no;
-
-    return client_it;
-}
-
-
-bool Server::check_name_availability(const std::string &name) const noexcept {
-    return name.empty() || std::all_of(server_state.clients.begin(), server_state.clients.end(),
-            [&name](const auto &client_session) {
-        return name != client_session.second.name;
-    });
 }
 
 
-void Server::send_events_to_clients() {
-    if (game_update_pending()) {
-        return;
+void Server::run_worker(uint32_t worker_no) {
+    std::vector<Room*> worker_rooms;
+    for (auto room_no = worker_no; room_no < rooms.size(); room_no += config.workers_number) {
+        worker_rooms.push_back(rooms[room_no].get());
     }
 
-    auto clients_num = server_state.clients.size();
-    auto now = std::chrono::system_clock::now();
-
-    for (std::size_t i = 0; i < clients_num; i++) {
-        assert(server_state.next_client != server_state.clients.end());
-        auto &client = server_state.next_client->second;
-        if (client.last_heartbeat_time + client_timeout < now) {
-            disconnect_client(server_state.next_client); // advances circularly next_client
-            continue;
+    // Poller tags are indices in worker_rooms, the timer gets the one past the end.
+    const uint64_t wake_timer_tag = worker_rooms.size();
+    Poller poller;
+    Timer wake_timer;  // fires at the earliest wake time of worker rooms
+    std::vector<uint32_t> interests(worker_rooms.size(), Poller::readable);
+
+    if (config.event_loop == EventLoop::Epoll) {
+        bool success = poller.init(worker_rooms.size() + 1) && wake_timer.init() &&
+                       poller.add(wake_timer.get_fd(), Poller::readable, wake_timer_tag);
+        for (std::size_t i = 0; success && i < worker_rooms.size(); i++) {
+            success = poller.add(worker_rooms[i]->get_fd(), interests[i], i);
         }
 
-        if (!client.got_new_game_event) {
-            client.next_event_no = 0;
+        if (!success) {
+            exit_with_error("Failed to initialize epoll event loop.");
         }
-
-        if (client.next_event_no >= game_state.serialized_events.size()) {
-            server_state.next_client = advance_iterator_circularly(
-                    server_state.clients, server_state.next_client);
-            continue;
-        }
-
-        MultipleGameEvent mge;
-        mge.game_id = game_state.game_id;
-        auto data_and_offset = mge.prepare_packet_from_cache(
-                game_state.serialized_events, client.next_event_no);
-
-        if (socket.send(data_and_offset.first,
-                        server_state.next_client->first) == Socket::Status::Done) {
-            if (client.next_event_no == 0) {
-                client.got_new_game_event = true;
-            }
-            client.next_event_no = data_and_offset.second;
-        }
-        // we are intentionally ignoring errors here
-
-        server_state.next_client = advance_iterator_circularly(
-                server_state.clients, server_state.next_client);
-        return;
-    }
-}
-
-
-void Server::update_game_state() {
-    game_state.next_update_time += 1'000'000us / config.rounds_per_second;
-
-    if (game_state.game_in_progress) {
-        update_lasting_game_state();
     }
-    else {
-        start_new_game_if_possible();
-    }
-}
-
 
-void Server::update_lasting_game_state() {
-    for (std::size_t ind = 0; ind < game_state.players.size(); ind++) {
-        auto &player = game_state.players[ind];
-        if (!player.alive) {
-            continue;
-        }
-
-        uint32_t last_x = player.pos_x;
-        uint32_t last_y = player.pos_y;
-
-        if (player.turn_direction == -1) {
-            player.angle -= config.turning_speed;
-            if (player.angle < 0) {
-                player.angle += 360;
-            }
-        }
-        else if (player.turn_direction == 1) {
-            player.angle += config.turning_speed;
-            if (player.angle >= 360) {
-                player.angle -= 360;
+    // Rooms which may have some work to do, others are only checked for wake time.
+    std::vector<bool> active(worker_rooms.size(), true);
+    while (true) {
+        bool pending_work = false;
+        auto now = Room::system_clock::now();
+        for (std::size_t i = 0; i < worker_rooms.size(); i++) {
+            auto room = worker_rooms[i];
+            if (!active[i] && now < room->get_next_wake_time()) {
+                continue;
             }
-        }
-
-        player.pos_x += cos(player.angle * deg_to_rad);
-        player.pos_y += sin(player.angle * deg_to_rad);
 
-        uint32_t new_x = player.pos_x;
-        uint32_t new_y = player.pos_y;
-
-        if (last_x == new_x && last_y == new_y) {
-            continue;
+            // In EventLoop::Epoll inactive room is processed only because of wake time,
+            // so its socket is known to be not readable.
+            room->process(active[i] || config.event_loop == EventLoop::Polling);
+            active[i] = room->pending_work();
+            pending_work = pending_work || active[i];
         }
 
-        if (!is_on_map(player.pos_x, player.pos_y) || map_get(new_x, new_y)) {
-            if (handle_player_eliminated_event(ind)) {
-                return;  // game over
-            }
-        }
-        else {
-            handle_pixel_event(ind, new_x, new_y);
+        if (pending_work) {
+            continue;
         }
-    }
-}
-
-
-void Server::start_new_game_if_possible() {
-    // TODO split into smaller functions
-    uint8_t counter = 0;
-    std::vector<std::string> names;
 
-    // Validate if all clients with non-empty login are ready
-    for (auto &client : server_state.clients) {
-        if (client.second.name.empty()) {
+        if (config.event_loop == EventLoop::Polling) {
+            std::this_thread::sleep_for(1ms);  // sleep a little bit if no more work
+            std::fill(active.begin(), active.end(), true);
             continue;
         }
 
-        if (!client.second.ready_to_play) {
-            return;
+        auto next_wake_time = Room::system_clock::time_point::max();
+        for (std::size_t i = 0; i < worker_rooms.size(); i++) {
+            auto room = worker_rooms[i];
+            next_wake_time = std::min(next_wake_time, room->get_next_wake_time());
+
+            auto interest = Poller::readable | (room->is_socket_congested() ? Poller::writable : 0);
+            if (interest != interests[i]) {
+                if (!poller.modify(room->get_fd(), interest, i)) {
+                    exit_with_error("Failed to update epoll interest.");
+                }
+                interests[i] = interest;
+            }
         }
 
-        counter++;
-        names.push_back(client.second.name);
-    }
-
-    if (counter < min_players_number) {
-        return;
-    }
-
-    std::cout << "Starting new game." << std::endl;
-
-    std::sort(names.begin(), names.end());
-
-    // Crop the player list if they do not fit into one UDP datagram
-    GameEvent ev;
-    ev.type = GameEvent::Type::NewGame;
-    ev.new_game_data.maxx = config.map_width;
-    ev.new_game_data.maxy = config.map_height;
-    ev.new_game_data.players_names = std::move(names);
-
-    auto &pl_names = ev.new_game_data.players_names;
-    auto names_size = ev.new_game_data.calculate_used_names_capacity();
-    while (ev.new_game_data.names_capacity < names_size) {
-        names_size -= pl_names.size() + 1;
-        pl_names.pop_back();
-    }
-
-    // Emit NewGame event and map clients to players
-    game_state.game_id = server_state.rand_gen.next();
-    game_state.serialized_events.clear();
-    game_state.game_in_progress = true;
-    emit_game_event(ev);
-    game_state.players.resize(pl_names.size());
-    game_state.alive_players_cnt = game_state.players.size();
-
-    for (auto &client : server_state.clients) {
-        client.second.got_new_game_event = false;
-        client.second.ready_to_play = false;
-        if (client.second.name.empty()) {
-            continue;
+        if (!wake_timer.arm(next_wake_time)) {
+            exit_with_error("Failed to arm wake timer.");
         }
 
-        auto it = std::lower_bound(pl_names.begin(), pl_names.end(),
-                                   client.second.name);
-        if (*it != client.second.name) {
-            continue;  // too many players, this one is not lucky
+        auto ready_cnt = poller.wait(-1);
+        if (ready_cnt < 0) {
+            exit_with_error("Failed to wait for events.");
         }
 
-        auto ind = it - pl_names.begin();
-        client.second.player_no = ind;
-        game_state.players[ind].name = client.second.name;
-    }
-
-    // Init map
-    game_state.map.resize(0);
-    game_state.map.resize(config.map_height * config.map_width, false);
-
-    // Init players
-    for (std::size_t ind = 0; ind < game_state.players.size(); ind++) {
-        auto &player = game_state.players[ind];
-
-        player.turn_direction = 0;
-        player.alive = true;
-        player.pos_x = (server_state.rand_gen.next() % config.map_width) + 0.5;
-        player.pos_y = (server_state.rand_gen.next() % config.map_height) + 0.5;
-        player.angle = server_state.rand_gen.next() % 360;
-
-        uint32_t x = player.pos_x;
-        uint32_t y = player.pos_y;
+        for (auto i = 0; i < ready_cnt; i++) {
+            auto tag = poller.ready_tag(i);
+            if (tag == wake_timer_tag) {
+                wake_timer.consume();
+                continue;
+            }
 
-        if (map_get(x, y)) {
-            if (handle_player_eliminated_event(ind)) {
-                return; // game over
+            active[tag] = true;
+            if (poller.ready_interest(i) & Poller::writable) {
+                worker_rooms[tag]->socket_writable();
             }
         }
-        else {
-            handle_pixel_event(ind, x, y);
-        }
-    }
-}
-
-
-bool Server::is_on_map(double x, double y) const {
-    return 0 <= x && x < config.map_width &&
-           0 <= y && y < config.map_height;
-}
-
-
-void Server::map_set(uint32_t x, uint32_t y) {
-    game_state.map[y * config.map_width + x] = true;
-}
-
-
-bool Server::map_get(uint32_t x, uint32_t y) const {
-    return game_state.map[y * config.map_width + x];
-}
-
-
-bool Server::game_update_pending() const {
-    return game_state.next_update_time <= std::chrono::system_clock::now();
-}
-
-
-bool Server::pending_work() const {
-    if (game_update_pending()) {
-        return true;
-    }
-
-    auto events_number = game_state.serialized_events.size();
-    if (std::any_of(server_state.clients.begin(), server_state.clients.end(),
-                    [events_number](const auto &client) {
-        return client.second.next_event_no < events_number;
-    })) {
-        return true;
     }
-
-    // TODO check if data awaiting on sockets (should not make real difference)
-
-    return false;
-}
-
-
-void Server::handle_pixel_event(uint8_t player_no, uint32_t x, uint32_t y) {
-    GameEvent ev;
-    ev.type = GameEvent::Type::Pixel;
-    ev.pixel_data.player_no = player_no;
-    ev.pixel_data.x = x;
-    ev.pixel_data.y = y;
-    emit_game_event(ev);
-
-    map_set(x, y);
-}
-
-
-bool Server::handle_player_eliminated_event(uint8_t player_no) {
-    GameEvent ev;
-    ev.type = GameEvent::Type::PlayerEliminated;
-    ev.player_eliminated_data.player_no = player_no;
-    emit_game_event(ev);
-    std::cout << log_name(game_state.players[player_no].name, true) << " is eliminated." << std::endl;
-
-    game_state.players[player_no].alive = false;
-    game_state.alive_players_cnt--;
-    if (game_state.alive_players_cnt <= 1) {
-        game_state.game_in_progress = false;
-        ev.type = GameEvent::Type::GameOver;
-        emit_game_event(ev);
-        std::cout << "Game over." << std::endl;
-
-        return true;
-    }
-
-    return false;
-}
-
-
-void Server::emit_game_event(GameEvent &event) {
-    event.event_no = game_state.serialized_events.size();
-    if (!event.validate(GameEvent::Format::Binary)) {
-        std::cout << "Warning: Tried to emit invalid game event. "
-                  << "Dropping it." << std::endl;
-    }
-
-    game_state.serialized_events.emplace_back(
-            event.serialize(GameEvent::Format::Binary));
-}
-
-
-// --------------------------------------- helpers
-template<typename T, typename It>
-static It advance_iterator_circularly(T &container, It it) {
-    ++it;
-    if (it == container.end()) {
-        it = container.begin();
-    }
-
-    return it;
-}
-
-
-static std::string log_name(const std::string &name, bool capitalized) {
-    std::string result = name.empty() ? "observer" : "player \"" + name + "\"";
-    if (capitalized) {
-        result[0] += 'A' - 'a';
-    }
-
-    return result;
 }
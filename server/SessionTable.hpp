@@ -0,0 +1,204 @@
+#pragma once
+
+#include <common/network/AddressKey.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+
+// Session store of fixed capacity keyed by client address. Everything is allocated
+// in the constructor: sessions live in pooled slots and lookups go through
+// an open addressing (linear probing) hash table of slot ids.
+//
+// Slot ids are stable for the whole session lifetime. Sessions are also linked
+// in insertion order, so iteration (and round-robin over clients) is stable,
+// regardless of the addresses and other sessions coming and going.
+template<typename T>
+class SessionTable final {
+public:
+    using Id = uint32_t;
+    static constexpr Id none = std::numeric_limits<Id>::max();
+
+private:
+    struct Slot {
+        AddressKey key;
+        T value;
+        Id prev;  // insertion order list, also free list (next only)
+        Id next;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<Id> index;  // hash table, size is a power of 2, at most half full
+    std::size_t used = 0;
+    Id first_id = none;
+    Id last_id = none;
+    Id free_id;
+
+public:
+    explicit SessionTable(std::size_t capacity)
+            : slots(capacity), index(index_size_for(capacity), none) {
+        for (std::size_t i = 0; i < capacity; i++) {
+            slots[i].next = i + 1 < capacity ? i + 1 : none;
+        }
+        free_id = capacity > 0 ? 0 : none;
+    }
+
+    std::size_t capacity() const noexcept {
+        return slots.size();
+    }
+
+    std::size_t size() const noexcept {
+        return used;
+    }
+
+    bool full() const noexcept {
+        return used == slots.size();
+    }
+
+    // Returns none if key is not present.
+    Id find(const AddressKey &key) const noexcept {
+        for (auto pos = home_of(key); index[pos] != none; pos = next_pos(pos)) {
+            if (slots[index[pos]].key == key) {
+                return index[pos];
+            }
+        }
+        return none;
+    }
+
+    // Key must not be present and table must not be full. The session is put
+    // at the end of iteration order, its value is left as it was in the pool.
+    Id insert(const AddressKey &key) noexcept {
+        assert(!full() && find(key) == none);
+
+        auto id = free_id;
+        auto &slot = slots[id];
+        free_id = slot.next;
+
+        slot.key = key;
+        slot.prev = last_id;
+        slot.next = none;
+        (last_id != none ? slots[last_id].next : first_id) = id;
+        last_id = id;
+
+        auto pos = home_of(key);
+        while (index[pos] != none) {
+            pos = next_pos(pos);
+        }
+        index[pos] = id;
+        used++;
+
+        return id;
+    }
+
+    void erase(Id id) noexcept {
+        auto &slot = slots[id];
+
+        // backward shift deletion keeps probe sequences without tombstones
+        auto pos = home_of(slot.key);
+        while (index[pos] != id) {
+            pos = next_pos(pos);
+        }
+        for (auto next = next_pos(pos); index[next] != none; next = next_pos(next)) {
+            auto home = home_of(slots[index[next]].key);
+            // can entry at next be moved to pos? (its home is not in (pos, next])
+            if (((next - home) & mask()) >= ((next - pos) & mask())) {
+                index[pos] = index[next];
+                pos = next;
+            }
+        }
+        index[pos] = none;
+
+        (slot.prev != none ? slots[slot.prev].next : first_id) = slot.next;
+        (slot.next != none ? slots[slot.next].prev : last_id) = slot.prev;
+        slot.next = free_id;
+        free_id = id;
+        used--;
+    }
+
+    T &operator[](Id id) noexcept {
+        return slots[id].value;
+    }
+
+    const T &operator[](Id id) const noexcept {
+        return slots[id].value;
+    }
+
+    const AddressKey &key(Id id) const noexcept {
+        return slots[id].key;
+    }
+
+    // Iteration in insertion order. Functions return none past the last session.
+    Id first() const noexcept {
+        return first_id;
+    }
+
+    Id next(Id id) const noexcept {
+        return slots[id].next;
+    }
+
+    // Like next(), but goes back to first() after the last session.
+    Id next_circular(Id id) const noexcept {
+        auto next_id = slots[id].next;
+        return next_id != none ? next_id : first_id;
+    }
+
+    // Iterators over values, for range-based for loops and algorithms.
+    template<typename Table, typename Value>
+    class basic_iterator final {
+    private:
+        Table *table;
+        Id id;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value*;
+        using reference = Value&;
+
+        basic_iterator(Table *table, Id id) noexcept : table(table), id(id) {}
+
+        Value &operator*() const noexcept { return (*table)[id]; }
+        Value *operator->() const noexcept { return &(*table)[id]; }
+        basic_iterator &operator++() noexcept { id = table->next(id); return *this; }
+        basic_iterator operator++(int) noexcept { auto it = *this; ++*this; return it; }
+        bool operator==(const basic_iterator &rhs) const noexcept { return id == rhs.id; }
+        bool operator!=(const basic_iterator &rhs) const noexcept { return id != rhs.id; }
+    };
+
+    using iterator = basic_iterator<SessionTable, T>;
+    using const_iterator = basic_iterator<const SessionTable, const T>;
+
+    iterator begin() noexcept { return iterator(this, first_id); }
+    iterator end() noexcept { return iterator(this, none); }
+    const_iterator begin() const noexcept { return const_iterator(this, first_id); }
+    const_iterator end() const noexcept { return const_iterator(this, none); }
+
+private:
+    static std::size_t index_size_for(std::size_t capacity) noexcept {
+        std::size_t size = 1;
+        while (size < 2 * capacity) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    std::size_t mask() const noexcept {
+        return index.size() - 1;
+    }
+
+    std::size_t home_of(const AddressKey &key) const noexcept {
+        return key.hash() & mask();
+    }
+
+    std::size_t next_pos(std::size_t pos) const noexcept {
+        return (pos + 1) & mask();
+    }
+};
+
+
+template<typename T>
+constexpr typename SessionTable<T>::Id SessionTable<T>::none;
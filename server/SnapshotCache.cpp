@@ -0,0 +1,128 @@
+#include <server/SnapshotCache.hpp>
+#include <common/protocol/GameEvent.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <endian.h>
+#include <zlib.h>
+
+
+// Trails are long runs of zeros in the bitmap, even the fastest level
+// squeezes them well.
+static constexpr auto compression_level = Z_BEST_SPEED;
+
+
+void SnapshotCache::reset(uint32_t game_id) {
+    this->game_id = game_id;
+    snapshot.clear();
+    consumed_cnt = 0;
+    sorted_pixels_cnt = 0;
+    built_events_cnt = 0;
+    datagrams.clear();
+}
+
+
+uint32_t SnapshotCache::get_consumed_cnt() const noexcept {
+    return consumed_cnt;
+}
+
+
+void SnapshotCache::consume(const char *data, std::size_t size) {
+    auto it = data;
+    auto const data_end = data + size;
+
+    while (it < data_end) {
+        auto len = be32toh(*reinterpret_cast<const uint32_t*>(it));
+        assert(be32toh(*reinterpret_cast<const uint32_t*>(it + 4)) == consumed_cnt);
+        auto type = static_cast<GameEvent::Type>(it[8]);
+        auto ev_data = it + 9;
+
+        switch (type) {
+            case GameEvent::Type::NewGame: {
+                snapshot.maxx = be32toh(*reinterpret_cast<const uint32_t*>(ev_data));
+                snapshot.maxy = be32toh(*reinterpret_cast<const uint32_t*>(ev_data + 4));
+                auto names_it = ev_data + 8;
+                auto const names_end = it + 4 + len;
+                while (names_it < names_end) {
+                    snapshot.players_names.emplace_back(names_it);
+                    names_it += snapshot.players_names.back().size() + 1;
+                }
+                break;
+            }
+
+            case GameEvent::Type::Pixel:
+                snapshot.pixels.push_back({
+                        be32toh(*reinterpret_cast<const uint32_t*>(ev_data + 1)),
+                        be32toh(*reinterpret_cast<const uint32_t*>(ev_data + 5)),
+                        static_cast<uint8_t>(ev_data[0])});
+                break;
+
+            case GameEvent::Type::PlayerEliminated:
+                snapshot.eliminated.push_back(ev_data[0]);
+                break;
+
+            default:
+                break;  // GameOver, not a part of snapshot
+        }
+
+        consumed_cnt++;
+        it += len + sizeof(uint32_t) * 2;  // + len + crc32
+    }
+}
+
+
+void SnapshotCache::update(uint32_t max_lag) {
+    if (built_events_cnt != 0 && built_events_cnt + max_lag >= consumed_cnt) {
+        return;
+    }
+    if (consumed_cnt == 0) {
+        return;  // not even NewGame
+    }
+
+    // new pixels are merged into already sorted ones
+    auto &pixels = snapshot.pixels;
+    auto sorted_end = pixels.begin() + sorted_pixels_cnt;
+    std::sort(sorted_end, pixels.end(), MapSnapshot::pixel_less);
+    std::inplace_merge(pixels.begin(), sorted_end, pixels.end(), MapSnapshot::pixel_less);
+    sorted_pixels_cnt = pixels.size();
+
+    snapshot.compress(compressed, compression_level);
+    built_events_cnt = snapshot.events_cnt();
+    datagrams.clear();
+
+    auto capacity = GameEvent::SnapshotData::fragment_capacity;
+    auto fragments_cnt = (compressed.size() + capacity - 1) / capacity;
+    if (fragments_cnt > UINT16_MAX) {
+        return;  // no snapshot, clients will get all events
+    }
+
+    GameEvent ev;
+    ev.event_no = built_events_cnt;
+    ev.type = GameEvent::Type::Snapshot;
+    ev.snapshot_data.fragments_cnt = fragments_cnt;
+    auto head = htobe32(game_id);
+
+    for (std::size_t no = 0; no < fragments_cnt; no++) {
+        ev.snapshot_data.fragment_no = no;
+        ev.snapshot_data.fragment.assign(compressed, no * capacity, capacity);
+
+        datagrams.emplace_back(reinterpret_cast<const char*>(&head), sizeof(head));
+        datagrams.back().append(ev.serialize(GameEvent::Format::Binary));
+    }
+}
+
+
+uint32_t SnapshotCache::get_events_cnt() const noexcept {
+    return built_events_cnt;
+}
+
+
+std::size_t SnapshotCache::get_datagrams_cnt() const noexcept {
+    return datagrams.size();
+}
+
+
+const std::string &SnapshotCache::get_datagram(std::size_t fragment_no) const noexcept {
+    assert(fragment_no < datagrams.size());
+    return datagrams[fragment_no];
+}
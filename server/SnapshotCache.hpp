@@ -0,0 +1,48 @@
+#pragma once
+
+#include <common/protocol/MapSnapshot.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Snapshot of the current game for clients joining in the middle of it, kept as
+// finished datagrams with GameEvent::Type::Snapshot fragments.
+//
+// Snapshot follows the game by consuming its events one by one (so it works
+// the same for played and replayed games), but compressing it is proportional to
+// the map size. Therefore datagrams are rebuilt only when they are outdated
+// by many events; clients get the missing events the usual way.
+class SnapshotCache final {
+private:
+    uint32_t game_id = 0;
+    MapSnapshot snapshot;
+    uint32_t consumed_cnt = 0;          // events consumed, GameOver included
+    std::size_t sorted_pixels_cnt = 0;  // snapshot.pixels[0, it) are sorted
+
+    uint32_t built_events_cnt = 0;  // described by datagrams, 0 if there are none
+    std::vector<std::string> datagrams;
+    std::string compressed;         // reused buffer
+
+public:
+    // Drops the snapshot, following events will be of given game.
+    void reset(uint32_t game_id);
+
+    // Number of events already consumed.
+    uint32_t get_consumed_cnt() const noexcept;
+    // Consumes serialized events which follow already consumed ones. Events are
+    // concatenated like in a datagram and must be valid, since they are ours.
+    void consume(const char *data, std::size_t size);
+
+    // Rebuilds datagrams if they describe less than get_consumed_cnt() - max_lag
+    // events (or there are none yet).
+    void update(uint32_t max_lag);
+    // Number of events described by datagrams. Client which got all of them
+    // continues with this event.
+    uint32_t get_events_cnt() const noexcept;
+    // Datagram number fragment_no is the one with that fragment. No datagrams
+    // means there is no snapshot (too large to be sent).
+    std::size_t get_datagrams_cnt() const noexcept;
+    const std::string &get_datagram(std::size_t fragment_no) const noexcept;
+};
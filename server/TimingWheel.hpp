@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+
+using TimingWheelHandle = uint32_t;
+
+
+// Hashed timing wheel for deadlines which are often postponed, like client
+// heartbeat timeouts. Time is split into ticks of given granularity and every
+// entry lives in the bucket of its deadline's tick (modulo number of buckets).
+//
+// Postponing a deadline is O(1) and does not touch the buckets: the entry is moved
+// to the proper bucket lazily, when its old bucket is reached by expire().
+// Therefore expire() only looks at buckets of ticks which passed since its last
+// call and at entries which were due in them.
+template<typename T>
+class TimingWheel final {
+public:
+    using system_clock = std::chrono::system_clock;
+    using Handle = TimingWheelHandle;
+
+private:
+    static constexpr Handle none = std::numeric_limits<Handle>::max();
+
+    struct Entry {
+        T value;
+        system_clock::time_point deadline;
+        Handle prev;
+        Handle next;
+        uint32_t bucket;  // none if not linked
+    };
+
+    system_clock::duration granularity;
+    std::vector<Handle> buckets;  // heads of doubly linked lists
+    std::vector<Entry> entries;
+    std::vector<Handle> free_handles;
+    int64_t current_tick;         // buckets before it are already processed
+
+public:
+    TimingWheel(system_clock::duration granularity, std::size_t buckets_cnt)
+            : granularity(granularity), buckets(buckets_cnt, none),
+              current_tick(tick_of(system_clock::now())) {
+        assert(buckets_cnt > 0);
+    }
+
+    Handle add(T value, system_clock::time_point deadline) {
+        Handle handle;
+        if (free_handles.empty()) {
+            handle = entries.size();
+            entries.emplace_back();
+        }
+        else {
+            handle = free_handles.back();
+            free_handles.pop_back();
+        }
+
+        auto &entry = entries[handle];
+        entry.value = std::move(value);
+        entry.deadline = deadline;
+        link(handle);
+
+        return handle;
+    }
+
+    // Sets new deadline. Later deadline is only remembered (the common case),
+    // earlier one relinks the entry.
+    void reschedule(Handle handle, system_clock::time_point deadline) noexcept {
+        auto &entry = entries[handle];
+        bool earlier = deadline < entry.deadline;
+        entry.deadline = deadline;
+        if (earlier || entry.bucket == none) {
+            unlink(handle);
+            link(handle);
+        }
+    }
+
+    // Handle must not be used after removing it.
+    void remove(Handle handle) {
+        unlink(handle);
+        entries[handle].value = T();
+        free_handles.push_back(handle);
+    }
+
+    // Appends values of entries whose deadline < now to expired. Such entries stay
+    // in the wheel unlinked, so they will not be reported again, but still have to
+    // be removed (or rescheduled) by the caller.
+    void expire(system_clock::time_point now, std::vector<T> &expired) {
+        auto now_tick = tick_of(now);
+        auto first_tick = std::max(current_tick,
+                                   now_tick - static_cast<int64_t>(buckets.size()) + 1);
+
+        for (auto tick = first_tick; tick <= now_tick; tick++) {
+            auto bucket = bucket_of(tick);
+            auto handle = buckets[bucket];
+            buckets[bucket] = none;  // detached, entries are put back one by one
+
+            while (handle != none) {
+                auto &entry = entries[handle];
+                auto next = entry.next;
+                entry.bucket = none;
+
+                if (entry.deadline < now) {
+                    expired.push_back(entry.value);
+                }
+                else {
+                    link(handle);  // postponed or not due in this round
+                }
+
+                handle = next;
+            }
+        }
+
+        // Current tick is not over yet, so its bucket will be checked again.
+        current_tick = now_tick;
+    }
+
+private:
+    int64_t tick_of(system_clock::time_point time) const noexcept {
+        return time.time_since_epoch() / granularity;
+    }
+
+    uint32_t bucket_of(int64_t tick) const noexcept {
+        return tick % static_cast<int64_t>(buckets.size());
+    }
+
+    void link(Handle handle) noexcept {
+        auto &entry = entries[handle];
+        entry.bucket = bucket_of(std::max(tick_of(entry.deadline), current_tick));
+        entry.prev = none;
+        entry.next = buckets[entry.bucket];
+        if (entry.next != none) {
+            entries[entry.next].prev = handle;
+        }
+        buckets[entry.bucket] = handle;
+    }
+
+    void unlink(Handle handle) noexcept {
+        auto &entry = entries[handle];
+        if (entry.bucket == none) {
+            return;
+        }
+
+        if (entry.prev != none) {
+            entries[entry.prev].next = entry.next;
+        }
+        else {
+            buckets[entry.bucket] = entry.next;
+        }
+
+        if (entry.next != none) {
+            entries[entry.next].prev = entry.prev;
+        }
+
+        entry.bucket = none;
+    }
+};
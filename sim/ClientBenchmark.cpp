@@ -0,0 +1,333 @@
+#include <sim/ClientBenchmark.hpp>
+#include <sim/Simulation.hpp>
+#include <client/GuiLineEncoder.hpp>
+#include <server/DatagramCache.hpp>
+#include <server/SessionTable.hpp>
+#include <common/RandomNumberGenerator.hpp>
+#include <common/network/AddressKey.hpp>
+#include <common/network/TcpSocket.hpp>
+#include <common/protocol/MultipleGameEvent.hpp>
+#include <common/protocol/MultipleGameEventView.hpp>
+#include <common/utils.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <arpa/inet.h>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+static constexpr uint64_t min_measured_events = 10'000'000;  // per measurement
+
+static constexpr uint64_t gui_input_lines = 10'000'000;
+static constexpr std::size_t gui_input_block_size = 64 * 1024;  // written at once
+
+static constexpr uint64_t min_gui_lines = 5'000'000;  // per measurement
+
+static constexpr uint64_t session_lookups = 10'000'000;  // per measurement
+static constexpr std::size_t sessions_numbers[] = {42, 1'000, 10'000};
+
+static const char *format_names[4] = {"plain", "compressed", "runs", "runs+compressed"};
+
+template<typename T>
+static void measure(const char *name, uint64_t items_cnt, const char *item, T &&action);
+
+
+ClientBenchmark::ClientBenchmark(const Game::Config &config, uint32_t players_number,
+                                 uint64_t seed, uint32_t turn_change_chance)
+        : game(config, "") {
+    RandomNumberGenerator rand_gen;
+    rand_gen.set_seed(seed);
+
+    std::vector<std::string> names;
+    for (uint32_t i = 0; i < players_number; i++) {
+        names.push_back("p" + std::to_string(i));
+    }
+
+    game.start(1, names, rand_gen);
+    auto players_cnt = game.get_players().size();
+    while (game.is_in_progress()) {
+        for (uint8_t player_no = 0; player_no < players_cnt; player_no++) {
+            if (rand_gen.next() % turn_change_chance == 0) {
+                game.set_turn_direction(player_no, static_cast<int8_t>(rand_gen.next() % 3) - 1);
+            }
+        }
+        game.update();
+    }
+
+    std::cout << "Game: " << config.map_width << " x " << config.map_height << ", "
+              << players_cnt << " players, " << game.get_events().size() << " events" << std::endl;
+}
+
+
+bool ClientBenchmark::is_known(const std::string &name) noexcept {
+    return name == "parse" || name == "gui_input" || name == "gui_lines" || name == "sessions";
+}
+
+
+void ClientBenchmark::run(const std::string &name) {
+    if (name == "parse") {
+        run_parse();
+    }
+    else if (name == "gui_input") {
+        run_gui_input();
+    }
+    else if (name == "gui_lines") {
+        run_gui_lines();
+    }
+    else if (name == "sessions") {
+        run_sessions();
+    }
+}
+
+
+void ClientBenchmark::run_parse() {
+    const auto &events = game.get_events();
+    auto repeats = std::max<uint64_t>(1, min_measured_events / events.size());
+
+    for (int format = 0; format < 4; format++) {
+        std::vector<std::string> datagrams;
+        DatagramCache cache(format & 1, format & 2);
+        cache.reset(game.get_game_id());
+        for (uint32_t event_no = 0; event_no < events.size(); ) {
+            const auto &datagram = cache.get(events, event_no);
+            datagrams.push_back(datagram.data);
+            event_no = datagram.end_event_no;
+        }
+
+        std::cout << format_names[format] << ", " << datagrams.size() << " datagrams:" << std::endl;
+        bool parsed = true;
+        MultipleGameEvent mge;
+        measure("  MultipleGameEvent", repeats * events.size(), "event", [&]() {
+            for (uint64_t i = 0; i < repeats; i++) {
+                for (const auto &datagram : datagrams) {
+                    parsed &= mge.deserialize(datagram);
+                }
+            }
+        });
+
+        MultipleGameEventView view;
+        measure("  MultipleGameEventView", repeats * events.size(), "event", [&]() {
+            for (uint64_t i = 0; i < repeats; i++) {
+                for (const auto &datagram : datagrams) {
+                    parsed &= view.parse(datagram.data(), datagram.size());
+                }
+            }
+        });
+
+        if (!parsed) {
+            exit_with_error("Failed to parse datagram.");
+        }
+    }
+}
+
+
+void ClientBenchmark::run_gui_input() {
+    static const std::string commands[] = {
+            "LEFT_KEY_DOWN", "LEFT_KEY_UP", "RIGHT_KEY_DOWN", "RIGHT_KEY_UP"};
+
+    // GUI's end is a plain socket, client's one is TcpSocket connected to it
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), addr_len) != 0
+            || listen(listen_fd, 1) != 0
+            || getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0) {
+        exit_with_error("Failed to create GUI socket.");
+    }
+
+    TcpSocket socket;
+    if (socket.connect(HostAddress("127.0.0.1", ntohs(addr.sin_port))) != Socket::Status::Done
+            || socket.set_blocking(false) != Socket::Status::Done) {
+        exit_with_error("Failed to connect to GUI socket.");
+    }
+    int gui_fd = accept(listen_fd, nullptr, nullptr);
+    close(listen_fd);
+    if (gui_fd < 0) {
+        exit_with_error("Failed to accept connection.");
+    }
+
+    std::string block;
+    uint64_t block_lines = 0;
+    while (block.size() + commands[block_lines % 4].size() + 1 <= gui_input_block_size) {
+        block.append(commands[block_lines % 4]);
+        block.push_back('\n');
+        block_lines++;
+    }
+
+    auto blocks_cnt = gui_input_lines / block_lines;
+    bool matched = true;
+    measure("TcpSocket::receive_line", blocks_cnt * block_lines, "line", [&]() {
+        for (uint64_t i = 0; i < blocks_cnt; i++) {
+            for (std::size_t sent = 0; sent < block.size(); ) {
+                auto result = write(gui_fd, block.data() + sent, block.size() - sent);
+                if (result < 0) {
+                    exit_with_error("Failed to write GUI input.");
+                }
+                sent += result;
+            }
+
+            const char *line;
+            std::size_t size;
+            for (uint64_t j = 0; j < block_lines; ) {
+                auto status = socket.receive_line(line, size);
+                if (status == Socket::Status::NotReady) {
+                    continue;  // rest of the block is still on its way
+                }
+                if (status != Socket::Status::Done) {
+                    exit_with_error("Failed to receive GUI input.");
+                }
+
+                const auto &command = commands[j % 4];
+                matched &= size == command.size() && memcmp(line, command.data(), size) == 0;
+                j++;
+            }
+        }
+    });
+    close(gui_fd);
+
+    if (!matched) {
+        exit_with_error("Received line differs from the sent one.");
+    }
+}
+
+
+void ClientBenchmark::run_gui_lines() {
+    const auto &events = game.get_events();
+    std::vector<GameEventView::PixelView> pixels;
+    MultipleGameEvent mge;
+    mge.game_id = game.get_game_id();
+    MultipleGameEventView view;
+    std::string datagram;
+    for (uint32_t event_no = 0; event_no < events.size(); ) {
+        datagram.clear();
+        event_no = mge.extend_packet_from_cache(datagram, events, event_no);
+        view.parse(datagram.data(), datagram.size());
+        for (const auto &event : view.events) {
+            if (event.type == GameEvent::Type::Pixel) {
+                pixels.push_back(event.pixel);
+            }
+        }
+    }
+
+    std::vector<std::string> names;
+    for (const auto &player : game.get_players()) {
+        names.push_back(player.name);
+    }
+    GuiLineEncoder encoder;
+    encoder.set_players_names(names);
+
+    // the way client formatted lines before GuiLineEncoder
+    GameEvent event;
+    event.type = GameEvent::Type::Pixel;
+    auto serialize = [&event, &names](const GameEventView::PixelView &pixel) {
+        event.pixel_data.x = pixel.x;
+        event.pixel_data.y = pixel.y;
+        event.pixel_data.player_name = names[pixel.player_no];
+        return event.serialize(GameEvent::Format::Text);
+    };
+
+    for (const auto &pixel : pixels) {
+        if (serialize(pixel) != encoder.pixel(pixel.x, pixel.y, pixel.player_no)) {
+            exit_with_error("GuiLineEncoder's line differs from GameEvent's one.");
+        }
+    }
+
+    auto repeats = std::max<uint64_t>(1, min_gui_lines / pixels.size());
+    std::size_t lines_size = 0;  // so formatting is not optimized out
+    measure("GameEvent::serialize", repeats * pixels.size(), "line", [&]() {
+        for (uint64_t i = 0; i < repeats; i++) {
+            for (const auto &pixel : pixels) {
+                lines_size += serialize(pixel).size();
+            }
+        }
+    });
+    measure("GuiLineEncoder::pixel", repeats * pixels.size(), "line", [&]() {
+        for (uint64_t i = 0; i < repeats; i++) {
+            for (const auto &pixel : pixels) {
+                lines_size += encoder.pixel(pixel.x, pixel.y, pixel.player_no).size();
+            }
+        }
+    });
+    std::cout << pixels.size() << " pixels, " << lines_size << " bytes of lines" << std::endl;
+}
+
+
+void ClientBenchmark::run_sessions() {
+    RandomNumberGenerator rand_gen;
+    rand_gen.set_seed(game.get_game_id());
+
+    for (auto sessions_cnt : sessions_numbers) {
+        // distinct IPv6 clients, the same port
+        std::vector<HostAddress::SocketAddress> addresses(sessions_cnt);
+        for (std::size_t i = 0; i < sessions_cnt; i++) {
+            auto &addr = addresses[i];
+            addr.ip_version = HostAddress::IpVersion::IPv6;
+            addr.addrlen = sizeof(addr.addr_v6);
+            addr.addr_v6.sin6_family = AF_INET6;
+            addr.addr_v6.sin6_port = htons(12345);
+            uint64_t words[2] = {rand_gen.next(), i};
+            memcpy(&addr.addr_v6.sin6_addr, words, sizeof(words));
+        }
+
+        std::vector<uint32_t> lookups(session_lookups);
+        for (auto &lookup : lookups) {
+            lookup = rand_gen.next() % sessions_cnt;
+        }
+
+        std::map<HostAddress, std::size_t> map;
+        SessionTable<std::size_t> table(sessions_cnt);
+        for (std::size_t i = 0; i < sessions_cnt; i++) {
+            HostAddress address;
+            address.set(addresses[i]);
+            map.emplace(std::move(address), i);
+            table[table.insert(AddressKey(addresses[i]))] = i;
+        }
+
+        std::cout << sessions_cnt << " sessions:" << std::endl;
+        std::size_t found = 0;  // so lookups are not optimized out
+        measure("  std::map", lookups.size(), "lookup", [&]() {
+            for (auto i : lookups) {
+                HostAddress address;  // as the server did for every datagram
+                address.set(addresses[i]);
+                found += map.find(address)->second == i;
+            }
+        });
+        measure("  SessionTable", lookups.size(), "lookup", [&]() {
+            for (auto i : lookups) {
+                found += table[table.find(AddressKey(addresses[i]))] == i;
+            }
+        });
+
+        if (found != 2 * lookups.size()) {
+            exit_with_error("Session was not found.");
+        }
+    }
+}
+
+
+// --------------------------------------- helpers
+template<typename T>
+static void measure(const char *name, uint64_t items_cnt, const char *item, T &&action) {
+    using clock = std::chrono::steady_clock;
+
+    auto allocations_before = allocations_cnt;
+    auto start_time = clock::now();
+    action();
+    double nanoseconds = std::chrono::duration<double, std::nano>(clock::now() - start_time).count();
+    auto allocations = allocations_cnt - allocations_before;
+
+    std::cout << std::left << std::setw(24) << name << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(8) << nanoseconds / items_cnt << " ns/" << item << ", "
+              << std::setprecision(2)
+              << std::setw(6) << static_cast<double>(allocations) / items_cnt
+              << " allocations/" << item << std::endl;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <server/Game.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Microbenchmarks of the client's hot paths (siktacka-sim -b name), run on
+// events of a single game played like in Simulation, and of the server's
+// session lookup. Where the measured code replaced older one which still
+// exists, both are measured on the same input.
+class ClientBenchmark final {
+private:
+    Game game;
+
+public:
+    // Plays the game whose events are used by all benchmarks.
+    ClientBenchmark(const Game::Config &config, uint32_t players_number,
+                    uint64_t seed, uint32_t turn_change_chance);
+
+    static bool is_known(const std::string &name) noexcept;
+    void run(const std::string &name);
+
+private:
+    // Datagrams with all events of the game (catch-up stream) in every format
+    // parsed by MultipleGameEvent::deserialize and by MultipleGameEventView.
+    void run_parse();
+    // Key commands sent by GUI over loopback TCP read by TcpSocket::receive_line,
+    // a block of lines is written and then all of them are read.
+    void run_gui_input();
+    // PIXEL lines of the game's events formatted by GameEvent::serialize
+    // with Format::Text and by GuiLineEncoder, which have to be the same.
+    void run_gui_lines();
+    // Random lookups of existing clients' addresses (as received) in
+    // std::map<HostAddress, ...>, which server used before, and SessionTable.
+    void run_sessions();
+};
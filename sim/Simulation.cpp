@@ -0,0 +1,260 @@
+#include <sim/Simulation.hpp>
+#include <sim/ClientBenchmark.hpp>
+#include <common/RandomNumberGenerator.hpp>
+#include <common/utils.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <new>
+#include <string>
+
+
+static constexpr auto max_map_dimension = 10'000;
+static constexpr auto max_turning_speed = 359;
+static constexpr auto max_players_number = 42;
+static constexpr auto max_games_number = 1'000'000;
+
+// Every allocation in the program is counted, so the engine's allocations
+// can be measured without any help from its code.
+uint64_t allocations_cnt = 0;
+
+
+Simulation::Simulation(int argc, char *argv[]) {
+    config.game.log_events = false;
+    parse_arguments(argc, argv);
+
+    // a benchmark uses only the first scenario
+    if (config.map_sizes.empty()) {
+        if (config.benchmark.empty()) {
+            config.map_sizes = {{800, 600}, {2'000, 2'000}, {10'000, 10'000}};
+        }
+        else {
+            config.map_sizes = {{2'000, 2'000}};
+        }
+    }
+    if (config.players_numbers.empty()) {
+        if (config.benchmark.empty()) {
+            config.players_numbers = {2, 8, 32};
+        }
+        else {
+            config.players_numbers = {16};
+        }
+    }
+}
+
+
+void Simulation::parse_arguments(int argc, char *argv[]) {
+    auto &game_config = config.game;
+    uint32_t map_width = 0;
+    uint32_t map_height = 0;
+
+    for (auto i = 1; i < argc; i += 2) {
+        if (strlen(argv[i]) != 2 || argv[i][0] != '-') {
+            print_usage(argv[0]);
+            exit_with_error("Invalid option: " + std::string(argv[i]));
+        }
+
+        auto opt = argv[i][1];
+        if (opt != 'W' && opt != 'H' && opt != 'n' && opt != 'g' && opt != 't' && opt != 'r'
+                && opt != 'c' && opt != 'm' && opt != 'v' && opt != 'b') {
+            print_usage(argv[0]);
+            exit_with_error("Unknown option: " + std::string(argv[i]));
+        }
+
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            exit_with_error("Missing argument for option: " + std::string(argv[i]));
+        }
+
+        try {
+            switch (opt) {
+                case 'W':
+                    map_width = to_number<uint32_t>("-W", argv[i + 1], 1, max_map_dimension);
+                    break;
+
+                case 'H':
+                    map_height = to_number<uint32_t>("-H", argv[i + 1], 1, max_map_dimension);
+                    break;
+
+                case 'n':
+                    config.players_numbers = {to_number<uint32_t>(
+                            "-n", argv[i + 1], 2, max_players_number)};
+                    break;
+
+                case 'g':
+                    config.games_number = to_number<decltype(config.games_number)>(
+                            "-g", argv[i + 1], 1, max_games_number);
+                    break;
+
+                case 't':
+                    game_config.turning_speed = to_number<decltype(game_config.turning_speed)>(
+                            "-t", argv[i + 1], 1, max_turning_speed);
+                    break;
+
+                case 'r':
+                    config.seed = to_number<uint64_t>("-r", argv[i + 1]);
+                    break;
+
+                case 'c':
+                    config.turn_change_chance = to_number<decltype(config.turn_change_chance)>(
+                            "-c", argv[i + 1], 1);
+                    break;
+
+                case 'm':
+                    game_config.movement = to_number<int>("-m", argv[i + 1], 0, 1) == 1
+                                           ? Game::Movement::FixedPoint : Game::Movement::Double;
+                    break;
+
+                case 'v':
+                    game_config.log_events = to_number<int>("-v", argv[i + 1], 0, 1) == 1;
+                    break;
+
+                case 'b':
+                    config.benchmark = argv[i + 1];
+                    if (!ClientBenchmark::is_known(config.benchmark)) {
+                        throw std::invalid_argument("Unknown benchmark: " + config.benchmark);
+                    }
+                    break;
+            }
+        }
+        catch (std::exception &exc) {
+            print_usage(argv[0]);
+            exit_with_error(exc.what());
+        }
+    }
+
+    if ((map_width == 0) != (map_height == 0)) {
+        print_usage(argv[0]);
+        exit_with_error("Options -W and -H must be given together.");
+    }
+    if (map_width != 0) {
+        config.map_sizes = {{map_width, map_height}};
+    }
+}
+
+
+void Simulation::print_usage(const char *name) const noexcept {
+    std::cerr << "Usage: " << name << " [-W n -H n] [-n n] [-g n] [-t n] [-r n] [-c n]"
+              << " [-m 0|1] [-v 0|1] [-b name]" << std::endl
+              << "  -W, -H  map size (default 800x600, 2000x2000 and 10000x10000)" << std::endl
+              << "  -n  number of players (default 2, 8 and 32)" << std::endl
+              << "  -g  number of games per scenario (default 1000)" << std::endl
+              << "  -t  turning speed (default 6)" << std::endl
+              << "  -r  random seed (default 42)" << std::endl
+              << "  -c  player changes turn direction once per n ticks on average (default 20)"
+              << std::endl
+              << "  -m  movement: 0 - double precision (default), 1 - fixed point" << std::endl
+              << "  -v  log game events: 0 - no (default), 1 - yes" << std::endl
+              << "  -b  run client benchmark on one game instead (default 2000x2000, 16 players):"
+              << std::endl
+              << "      parse - parsing received datagrams" << std::endl
+              << "      gui_input - reading key commands from GUI" << std::endl
+              << "      gui_lines - formatting lines for GUI" << std::endl
+              << "      sessions - server's lookups of clients' sessions" << std::endl;
+}
+
+
+void Simulation::run() {
+    if (!config.benchmark.empty()) {
+        auto game_config = config.game;
+        game_config.map_width = config.map_sizes[0].first;
+        game_config.map_height = config.map_sizes[0].second;
+        ClientBenchmark benchmark(game_config, config.players_numbers[0], config.seed,
+                                  config.turn_change_chance);
+        benchmark.run(config.benchmark);
+        return;
+    }
+
+    std::cout << "Movement: " << (config.game.movement == Game::Movement::FixedPoint
+                                  ? "fixed point" : "double")
+              << ", turning speed: " << config.game.turning_speed
+              << ", games per scenario: " << config.games_number << std::endl;
+
+    for (const auto &map_size : config.map_sizes) {
+        for (auto players_number : config.players_numbers) {
+            run_scenario({map_size.first, map_size.second, players_number});
+        }
+    }
+}
+
+
+void Simulation::run_scenario(const Scenario &scenario) {
+    using clock = std::chrono::steady_clock;
+
+    auto game_config = config.game;
+    game_config.map_width = scenario.map_width;
+    game_config.map_height = scenario.map_height;
+    Game game(game_config, "");
+
+    RandomNumberGenerator rand_gen;
+    rand_gen.set_seed(config.seed);
+
+    std::vector<std::string> names;
+    for (uint32_t i = 0; i < scenario.players_number; i++) {
+        names.push_back("p" + std::to_string(i));
+    }
+
+    uint64_t ticks = 0;
+    uint64_t events = 0;
+    uint64_t start_allocations = 0;
+    uint64_t tick_allocations = 0;
+    auto start_time = clock::now();
+
+    for (uint32_t game_no = 0; game_no < config.games_number; game_no++) {
+        auto allocations_before = allocations_cnt;
+        game.start(game_no, names, rand_gen);
+        start_allocations += allocations_cnt - allocations_before;
+
+        allocations_before = allocations_cnt;
+        auto players_cnt = game.get_players().size();
+        while (game.is_in_progress()) {
+            for (uint8_t player_no = 0; player_no < players_cnt; player_no++) {
+                if (rand_gen.next() % config.turn_change_chance == 0) {
+                    game.set_turn_direction(player_no,
+                                            static_cast<int8_t>(rand_gen.next() % 3) - 1);
+                }
+            }
+
+            game.update();
+            ticks++;
+        }
+        tick_allocations += allocations_cnt - allocations_before;
+        events += game.get_events().size();
+    }
+
+    double seconds = std::chrono::duration<double>(clock::now() - start_time).count();
+    double games = config.games_number;
+    std::cout << std::setw(5) << scenario.map_width << " x " << std::setw(5) << scenario.map_height
+              << ", " << std::setw(2) << scenario.players_number << " players: "
+              << std::fixed << std::setprecision(0)
+              << std::setw(10) << ticks / seconds << " ticks/s, "
+              << std::setw(10) << events / seconds << " events/s, "
+              << std::setprecision(1) << std::setw(8) << ticks / games << " ticks/game, "
+              << std::setprecision(4) << static_cast<double>(tick_allocations) / std::max<uint64_t>(ticks, 1)
+              << " allocations/tick, "
+              << std::setprecision(1) << start_allocations / games << " allocations/start"
+              << std::endl;
+}
+
+
+// --------------------------------------- allocation counting
+void *operator new(std::size_t size) {
+    allocations_cnt++;
+    if (auto ptr = std::malloc(size != 0 ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
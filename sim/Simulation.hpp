@@ -0,0 +1,45 @@
+#pragma once
+
+#include <server/Game.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Number of allocations made by the program so far.
+extern uint64_t allocations_cnt;
+
+
+// Main class for siktacka-sim. Plays games back to back on the game engine
+// with random turn inputs and without real-time pacing, then reports
+// how fast the engine is for every scenario (map size and players number).
+class Simulation final {
+private:
+    struct Scenario {
+        uint32_t map_width;
+        uint32_t map_height;
+        uint32_t players_number;
+    };
+
+    // simulation config
+    struct {
+        Game::Config game;
+        uint64_t seed = 42;
+        uint32_t games_number = 1'000;  // per scenario
+        uint32_t turn_change_chance = 20;  // player changes turn direction once per n ticks
+                                           // on average
+        std::vector<std::pair<uint32_t, uint32_t>> map_sizes;
+        std::vector<uint32_t> players_numbers;
+        std::string benchmark;  // run instead of games, see ClientBenchmark
+    } config;
+
+public:
+    Simulation(int argc, char *argv[]);
+    void run();
+
+private:
+    void parse_arguments(int argc, char *argv[]);
+    void print_usage(const char *name) const noexcept;
+    void run_scenario(const Scenario &scenario);
+};
@@ -0,0 +1,19 @@
+#include <sim/Simulation.hpp>
+
+#include <iostream>
+
+
+int main(int argc, char *argv[]) {
+    try {
+        Simulation simulation(argc, argv);
+        simulation.run();
+    }
+    catch (std::exception &exc) {
+        std::cerr << "Error occured: " << exc.what() << std::endl;
+    }
+    catch (...) {
+        std::cerr << "Unkown error occured." << std::endl;
+    }
+
+    return 0;
+}